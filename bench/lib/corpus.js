@@ -0,0 +1,158 @@
+// Fixed action corpus replayed by the benchmarks. Every round starts from an
+// empty chain, so the corpus is deterministic and replays cleanly.
+
+const { nameToBigInt, symbolToBigInt, pack } = require("./serialize");
+
+const CONTRACT = "apoc.token";
+const SYMBOL = { precision: 5, code: "APOC" };
+const SYMBOL_CODE = symbolToBigInt(SYMBOL.precision, SYMBOL.code) >> 8n;
+const HISTOGRAM_BUCKETS = 20;
+const NAME_CHARS = "abcdefghijklmnopqrstuvwxyz12345";
+
+// dense, valid account names: u + base-31 digits
+function accountName(prefix, index) {
+  let name = "";
+  do {
+    name = NAME_CHARS[index % NAME_CHARS.length] + name;
+    index = Math.floor(index / NAME_CHARS.length);
+  } while (index > 0);
+  return `${prefix}${name}`;
+}
+
+const action = (name, auths, write) => ({
+  name: nameToBigInt(name),
+  label: name,
+  auths: auths.map(nameToBigInt),
+  data: pack(write),
+});
+
+const create = () =>
+  action("create", [CONTRACT], (w) =>
+    w.name(CONTRACT).asset("1000000000.00000 APOC")
+  );
+
+const issue = (quantity) =>
+  action("issue", [CONTRACT], (w) =>
+    w.name(CONTRACT).asset(quantity).string("")
+  );
+
+const transfer = (from, to, quantity) =>
+  action("transfer", [from], (w) =>
+    w.name(from).name(to).asset(quantity).string("")
+  );
+
+const open = (owner) =>
+  action("open", [CONTRACT], (w) =>
+    w.name(owner).symbol(SYMBOL.precision, SYMBOL.code).name(CONTRACT)
+  );
+
+const close = (owner) =>
+  action("close", [owner], (w) =>
+    w.name(owner).symbol(SYMBOL.precision, SYMBOL.code)
+  );
+
+// table rows as the contract stores them, for hydraload or a native load
+const accountRow = (owner, balance) => ({
+  table: "accounts",
+  scope: nameToBigInt(owner),
+  primary: SYMBOL_CODE,
+  data: pack((w) => w.asset(balance)),
+});
+
+const holderRow = (id, owner) => ({
+  table: "holderids",
+  scope: nameToBigInt(CONTRACT),
+  primary: BigInt(id),
+  data: pack((w) => w.uint64(id).name(owner)),
+});
+
+// marks the balance row of `owner` as counted in the histogram
+const memberRow = (owner) => ({
+  table: "histmembers",
+  scope: SYMBOL_CODE,
+  primary: nameToBigInt(owner),
+  data: pack((w) => w.name(owner)),
+});
+
+// the token's stat row, `supply` and `maxSupply` in base units
+const statRow = (supply, maxSupply, issuer) => ({
+  table: "stat",
+  scope: SYMBOL_CODE,
+  primary: SYMBOL_CODE,
+  data: pack((w) =>
+    w
+      .int64(supply)
+      .symbol(SYMBOL.precision, SYMBOL.code)
+      .int64(maxSupply)
+      .symbol(SYMBOL.precision, SYMBOL.code)
+      .name(issuer)
+  ),
+});
+
+// `holders` counts per balance bucket, see token::balance_bucket
+const histogramRow = (holders) => ({
+  table: "histogram",
+  scope: SYMBOL_CODE,
+  primary: SYMBOL_CODE,
+  data: pack((w) =>
+    w.symbol(SYMBOL.precision, SYMBOL.code).vector(holders, (w, count) => w.uint64(count))
+  ),
+});
+
+// the histogram bucket of an asset string, the number of digits of its amount
+const balanceBucket = (balance) => {
+  const amount = BigInt(balance.split(" ")[0].replace(".", ""));
+  return amount === 0n ? 0 : amount.toString().length;
+};
+
+// bulk-loads `rows` through the hydraload fixture action
+const hydraload = (rows) =>
+  action("hydraload", ["eosio"], (w) =>
+    w.vector(rows, (w, row) => w.name(row.table).uint64(row.scope).blob(row.data))
+  );
+
+// the corpus and the accounts that must exist for it to replay
+function buildCorpus({ holders = 1000, batch = 50, opens = 200, transfers = 1000 } = {}) {
+  const holderNames = Array.from({ length: holders }, (_, i) => accountName("h", i));
+  const openNames = Array.from({ length: opens }, (_, i) => accountName("o", i));
+
+  const setup = [create(), issue("1000000.00000 APOC")];
+  const actions = [];
+  for (let i = 0; i < holders; i += batch) {
+    actions.push(
+      hydraload(holderNames.slice(i, i + batch).map((owner) => accountRow(owner, "100.00000 APOC")))
+    );
+  }
+  openNames.forEach((owner) => actions.push(open(owner)));
+  for (let i = 0; i < transfers; i++) {
+    const from = holderNames[i % holders];
+    const to = holderNames[(i * 7 + 1) % holders];
+    if (from !== to) actions.push(transfer(from, to, "0.00001 APOC"));
+  }
+  openNames.forEach((owner) => actions.push(close(owner)));
+
+  return {
+    accounts: [CONTRACT, "eosio", ...holderNames, ...openNames],
+    setup,
+    actions,
+  };
+}
+
+module.exports = {
+  CONTRACT,
+  HISTOGRAM_BUCKETS,
+  accountName,
+  accountRow,
+  holderRow,
+  memberRow,
+  statRow,
+  histogramRow,
+  balanceBucket,
+  buildCorpus,
+  create,
+  issue,
+  transfer,
+  open,
+  close,
+  hydraload,
+};
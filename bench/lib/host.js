@@ -0,0 +1,691 @@
+// In-memory stand-in for the nodeos host: the multi_index database
+// intrinsics, action context and the handful of system intrinsics the
+// contract imports. Anything else the module imports is stubbed to throw,
+// so a missing intrinsic shows up as a failed action instead of silently
+// skewing the timings.
+
+const crypto = require("crypto");
+
+// billable sizes nodeos charges on top of the row data
+const TABLE_OVERHEAD_BYTES = 108;
+const ROW_OVERHEAD_BYTES = 112;
+const SECONDARY_ROW_OVERHEAD_BYTES = 128;
+
+class AssertFailure extends Error {}
+class ContractExit extends Error {}
+
+// upper bound of a sorted BigInt array
+function upperIndex(keys, id) {
+  let lo = 0;
+  let hi = keys.length;
+  while (lo < hi) {
+    const mid = (lo + hi) >>> 1;
+    if (keys[mid] <= id) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+function lowerIndex(keys, id) {
+  let lo = 0;
+  let hi = keys.length;
+  while (lo < hi) {
+    const mid = (lo + hi) >>> 1;
+    if (keys[mid] < id) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+const KEY_MASK = (1n << 64n) - 1n;
+
+// ordered map over BigInt keys, a B+ tree like the chainbase indexes nodeos
+// keeps its tables in, so lookups cost more as the state grows. Deletes do
+// not rebalance: emptied leaves stay linked in and the height never shrinks.
+class OrderedIndex {
+  constructor(order = 64) {
+    this.order = order;
+    this.root = { leaf: true, keys: [], values: [], prev: null, next: null };
+    this.size = 0;
+    this.height = 1;
+  }
+
+  leafFor(key) {
+    let node = this.root;
+    while (!node.leaf) node = node.children[upperIndex(node.keys, key)];
+    return node;
+  }
+
+  get(key) {
+    const leaf = this.leafFor(key);
+    const i = lowerIndex(leaf.keys, key);
+    return i < leaf.keys.length && leaf.keys[i] === key ? leaf.values[i] : undefined;
+  }
+
+  has(key) {
+    return this.get(key) !== undefined;
+  }
+
+  set(key, value) {
+    const split = this.insertInto(this.root, key, value);
+    if (split) {
+      this.root = { leaf: false, keys: [split.key], children: [this.root, split.node] };
+      this.height++;
+    }
+  }
+
+  // inserts below `node`, returning the separator and new right sibling
+  // when `node` had to split
+  insertInto(node, key, value) {
+    if (node.leaf) {
+      const i = lowerIndex(node.keys, key);
+      if (i < node.keys.length && node.keys[i] === key) {
+        node.values[i] = value;
+        return null;
+      }
+      node.keys.splice(i, 0, key);
+      node.values.splice(i, 0, value);
+      this.size++;
+      if (node.keys.length <= this.order) return null;
+      const half = node.keys.length >>> 1;
+      const right = {
+        leaf: true,
+        keys: node.keys.splice(half),
+        values: node.values.splice(half),
+        prev: node,
+        next: node.next,
+      };
+      if (node.next) node.next.prev = right;
+      node.next = right;
+      return { key: right.keys[0], node: right };
+    }
+    const c = upperIndex(node.keys, key);
+    const split = this.insertInto(node.children[c], key, value);
+    if (!split) return null;
+    node.keys.splice(c, 0, split.key);
+    node.children.splice(c + 1, 0, split.node);
+    if (node.keys.length <= this.order) return null;
+    const half = node.keys.length >>> 1;
+    const up = node.keys[half];
+    const right = { leaf: false, keys: node.keys.splice(half + 1), children: node.children.splice(half + 1) };
+    node.keys.length = half;
+    return { key: up, node: right };
+  }
+
+  delete(key) {
+    const leaf = this.leafFor(key);
+    const i = lowerIndex(leaf.keys, key);
+    if (i >= leaf.keys.length || leaf.keys[i] !== key) return false;
+    leaf.keys.splice(i, 1);
+    leaf.values.splice(i, 1);
+    this.size--;
+    return true;
+  }
+
+  // first key at or after position `i` of `leaf`, skipping emptied leaves
+  static forward(leaf, i) {
+    while (i >= leaf.keys.length) {
+      leaf = leaf.next;
+      if (!leaf) return undefined;
+      i = 0;
+    }
+    return leaf.keys[i];
+  }
+
+  static backward(leaf, i) {
+    while (i < 0) {
+      leaf = leaf.prev;
+      if (!leaf) return undefined;
+      i = leaf.keys.length - 1;
+    }
+    return leaf.keys[i];
+  }
+
+  // first key not less than `key`
+  lower(key) {
+    const leaf = this.leafFor(key);
+    return OrderedIndex.forward(leaf, lowerIndex(leaf.keys, key));
+  }
+
+  // first key greater than `key`
+  upper(key) {
+    const leaf = this.leafFor(key);
+    return OrderedIndex.forward(leaf, upperIndex(leaf.keys, key));
+  }
+
+  // last key less than `key`
+  before(key) {
+    const leaf = this.leafFor(key);
+    return OrderedIndex.backward(leaf, lowerIndex(leaf.keys, key) - 1);
+  }
+
+  last() {
+    let node = this.root;
+    while (!node.leaf) node = node.children[node.children.length - 1];
+    return OrderedIndex.backward(node, node.keys.length - 1);
+  }
+}
+
+// (code, scope, table) as one key, the order chainbase sorts tables in
+const tableKey = (code, scope, table) => (code << 128n) | (scope << 64n) | table;
+
+// (secondary, primary) as one key, the order idx64 entries are sorted in
+const secondaryKey = (sec, pri) => (sec << 64n) | pri;
+
+class Table {
+  constructor(code, scope, table) {
+    this.code = code;
+    this.scope = scope;
+    this.table = table;
+    this.rows = new OrderedIndex();
+  }
+
+  insert(id, row) {
+    this.rows.set(id, row);
+  }
+
+  remove(id) {
+    this.rows.delete(id);
+  }
+}
+
+// idx64 secondary index: (secondary, primary) entries plus the secondary
+// value of each primary key
+class SecondaryIndex {
+  constructor(code, scope, table) {
+    this.code = code;
+    this.scope = scope;
+    this.table = table;
+    this.entries = new OrderedIndex();
+    this.byPrimary = new OrderedIndex();
+  }
+
+  insert(sec, pri) {
+    this.entries.set(secondaryKey(sec, pri), pri);
+    this.byPrimary.set(pri, sec);
+  }
+
+  remove(pri) {
+    this.entries.delete(secondaryKey(this.byPrimary.get(pri), pri));
+    this.byPrimary.delete(pri);
+  }
+}
+
+class Chain {
+  constructor() {
+    this.tables = new OrderedIndex();
+    this.indexes = new OrderedIndex();
+    this.accounts = new Set();
+    this.now = 1600000000000000n;
+    this.billableBytes = 0;
+    this.journal = null;
+  }
+
+  // starts journaling writes, so a failed action can be undone like nodeos
+  // undoes its session
+  begin() {
+    this.journal = [];
+    this.journalBytes = this.billableBytes;
+  }
+
+  commit() {
+    this.journal = null;
+  }
+
+  rollback() {
+    while (this.journal.length > 0) this.journal.pop()();
+    this.billableBytes = this.journalBytes;
+    this.journal = null;
+  }
+
+  // records how to undo a write made by the running action
+  record(undo) {
+    if (this.journal) this.journal.push(undo);
+  }
+
+  table(code, scope, table, create) {
+    const key = tableKey(code, scope, table);
+    let t = this.tables.get(key);
+    if (!t && create) {
+      t = new Table(code, scope, table);
+      this.tables.set(key, t);
+      this.billableBytes += TABLE_OVERHEAD_BYTES;
+      this.record(() => this.tables.delete(key));
+    }
+    return t;
+  }
+
+  dropTable(t) {
+    const key = tableKey(t.code, t.scope, t.table);
+    this.tables.delete(key);
+    this.billableBytes -= TABLE_OVERHEAD_BYTES;
+    this.record(() => this.tables.set(key, t));
+  }
+
+  index(code, scope, table, create) {
+    const key = tableKey(code, scope, table);
+    let ix = this.indexes.get(key);
+    if (!ix && create) {
+      ix = new SecondaryIndex(code, scope, table);
+      this.indexes.set(key, ix);
+      this.billableBytes += TABLE_OVERHEAD_BYTES;
+      this.record(() => this.indexes.delete(key));
+    }
+    return ix;
+  }
+
+  dropIndex(ix) {
+    const key = tableKey(ix.code, ix.scope, ix.table);
+    this.indexes.delete(key);
+    this.billableBytes -= TABLE_OVERHEAD_BYTES;
+    this.record(() => this.indexes.set(key, ix));
+  }
+
+  // stores a row without going through the contract, like a native fixture load
+  storeRow(code, scope, table, id, payer, data) {
+    const t = this.table(code, scope, table, true);
+    if (t.rows.has(id)) throw new AssertFailure("storeRow: duplicate primary key");
+    t.insert(id, { payer, data });
+    this.billableBytes += ROW_OVERHEAD_BYTES + data.length;
+  }
+
+  // stores an idx64 entry for row `id`, the native counterpart of db_idx64_store
+  storeSecondary(code, scope, table, id, secondary) {
+    const ix = this.index(code, scope, table, true);
+    if (ix.byPrimary.has(id)) throw new AssertFailure("storeSecondary: duplicate primary key");
+    ix.insert(secondary, id);
+    this.billableBytes += SECONDARY_ROW_OVERHEAD_BYTES;
+  }
+}
+
+// per-action state: authorizations, action data and the iterator cache,
+// which nodeos also resets for every action
+class ActionContext {
+  constructor(chain, receiver, data, auths) {
+    this.chain = chain;
+    this.receiver = receiver;
+    this.data = data;
+    this.auths = new Set(auths);
+    this.iters = [];
+    this.iterIndex = new Map();
+    this.tabs = [];
+    this.tabIndex = new Map();
+    this.idxIters = [];
+    this.idxIterIndex = new Map();
+    this.idxTabs = [];
+    this.idxTabIndex = new Map();
+    this.returnValue = null;
+  }
+
+  idxIterator(ix, pri) {
+    const key = `${ix.code}:${ix.scope}:${ix.table}:${pri}`;
+    let itr = this.idxIterIndex.get(key);
+    if (itr === undefined) {
+      itr = this.idxIters.length;
+      this.idxIters.push({ ix, pri });
+      this.idxIterIndex.set(key, itr);
+    }
+    return itr;
+  }
+
+  idxEnd(ix) {
+    let idx = this.idxTabIndex.get(ix);
+    if (idx === undefined) {
+      idx = this.idxTabs.length;
+      this.idxTabs.push(ix);
+      this.idxTabIndex.set(ix, idx);
+    }
+    return -(idx + 2);
+  }
+
+  idxRow(itr) {
+    const entry = this.idxIters[itr];
+    if (!entry || !entry.ix.byPrimary.has(entry.pri)) {
+      throw new AssertFailure("dereference of invalid secondary iterator");
+    }
+    return entry;
+  }
+
+  iterator(t, id) {
+    const key = `${t.code}:${t.scope}:${t.table}:${id}`;
+    let itr = this.iterIndex.get(key);
+    if (itr === undefined) {
+      itr = this.iters.length;
+      this.iters.push({ t, id });
+      this.iterIndex.set(key, itr);
+    }
+    return itr;
+  }
+
+  end(t) {
+    let idx = this.tabIndex.get(t);
+    if (idx === undefined) {
+      idx = this.tabs.length;
+      this.tabs.push(t);
+      this.tabIndex.set(t, idx);
+    }
+    return -(idx + 2);
+  }
+
+  row(itr) {
+    const entry = this.iters[itr];
+    if (!entry || !entry.t.rows.has(entry.id)) {
+      throw new AssertFailure("dereference of invalid iterator");
+    }
+    return entry;
+  }
+}
+
+// builds the import object for `module`, bound to `getMemory` and the
+// current action context returned by `getContext`
+function createImports(module, getMemory, getContext) {
+  const mem = () => new Uint8Array(getMemory().buffer);
+  const view = () => new DataView(getMemory().buffer);
+  const cstring = (ptr) => {
+    const bytes = mem();
+    let end = ptr;
+    while (bytes[end] !== 0) end++;
+    return Buffer.from(bytes.subarray(ptr, end)).toString("utf8");
+  };
+  const copyIn = (ptr, len) => Buffer.from(mem().subarray(ptr, ptr + len));
+  const requireAuth = (account) => {
+    if (!getContext().auths.has(account)) {
+      throw new AssertFailure(`missing authority of ${account}`);
+    }
+  };
+
+  const env = {
+    // action
+    read_action_data(ptr, len) {
+      const data = getContext().data;
+      if (len === 0) return data.length;
+      const size = Math.min(len, data.length);
+      mem().set(data.subarray(0, size), ptr);
+      return size;
+    },
+    action_data_size: () => getContext().data.length,
+    current_receiver: () => getContext().receiver,
+    require_auth: requireAuth,
+    require_auth2: (account) => requireAuth(account),
+    has_auth: (account) => (getContext().auths.has(account) ? 1 : 0),
+    is_account: (account) => (getContext().chain.accounts.has(account) ? 1 : 0),
+    require_recipient: () => {},
+    send_inline: () => {},
+    send_context_free_inline: () => {},
+    publication_time: () => getContext().chain.now,
+    current_time: () => getContext().chain.now,
+    set_action_return_value(ptr, len) {
+      getContext().returnValue = copyIn(ptr, len);
+    },
+
+    // system
+    eosio_assert(cond, msg) {
+      if (!cond) throw new AssertFailure(cstring(msg));
+    },
+    eosio_assert_message(cond, ptr, len) {
+      if (!cond) throw new AssertFailure(copyIn(ptr, len).toString("utf8"));
+    },
+    eosio_assert_code(cond, code) {
+      if (!cond) throw new AssertFailure(`assertion failure with error code: ${code}`);
+    },
+    eosio_exit() {
+      throw new ContractExit();
+    },
+    abort() {
+      throw new AssertFailure("abort() called");
+    },
+
+    // memory, imported by older CDT releases
+    memcpy(dest, src, len) {
+      mem().copyWithin(dest, src, src + len);
+      return dest;
+    },
+    memmove(dest, src, len) {
+      mem().copyWithin(dest, src, src + len);
+      return dest;
+    },
+    memset(ptr, value, len) {
+      mem().fill(value, ptr, ptr + len);
+      return ptr;
+    },
+
+    // crypto
+    sha256(ptr, len, hash) {
+      const digest = crypto.createHash("sha256").update(copyIn(ptr, len)).digest();
+      mem().set(digest, hash);
+    },
+
+    // database
+    db_store_i64(scope, table, payer, id, ptr, len) {
+      const ctx = getContext();
+      const t = ctx.chain.table(ctx.receiver, scope, table, true);
+      if (t.rows.has(id)) throw new AssertFailure("db_store_i64: duplicate primary key");
+      t.insert(id, { payer, data: copyIn(ptr, len) });
+      ctx.chain.billableBytes += ROW_OVERHEAD_BYTES + len;
+      ctx.chain.record(() => t.remove(id));
+      return ctx.iterator(t, id);
+    },
+    db_update_i64(itr, payer, ptr, len) {
+      const ctx = getContext();
+      const { t, id } = ctx.row(itr);
+      const row = t.rows.get(id);
+      const old = { payer: row.payer, data: row.data };
+      ctx.chain.record(() => Object.assign(row, old));
+      if (payer !== 0n) row.payer = payer;
+      ctx.chain.billableBytes += len - row.data.length;
+      row.data = copyIn(ptr, len);
+    },
+    db_remove_i64(itr) {
+      const ctx = getContext();
+      const { t, id } = ctx.row(itr);
+      const row = t.rows.get(id);
+      ctx.chain.billableBytes -= ROW_OVERHEAD_BYTES + row.data.length;
+      t.remove(id);
+      ctx.chain.record(() => t.insert(id, row));
+      if (t.rows.size === 0) ctx.chain.dropTable(t);
+    },
+    db_get_i64(itr, ptr, len) {
+      const { t, id } = getContext().row(itr);
+      const data = t.rows.get(id).data;
+      if (len === 0) return data.length;
+      const size = Math.min(len, data.length);
+      mem().set(data.subarray(0, size), ptr);
+      return size;
+    },
+    db_next_i64(itr, primary) {
+      const ctx = getContext();
+      if (itr < -1) return -1;
+      const { t, id } = ctx.row(itr);
+      const next = t.rows.upper(id);
+      if (next === undefined) return ctx.end(t);
+      view().setBigUint64(primary, next, true);
+      return ctx.iterator(t, next);
+    },
+    db_previous_i64(itr, primary) {
+      const ctx = getContext();
+      let t;
+      let prev;
+      if (itr < -1) {
+        t = ctx.tabs[-itr - 2];
+        prev = t.rows.last();
+      } else {
+        const entry = ctx.row(itr);
+        t = entry.t;
+        prev = t.rows.before(entry.id);
+      }
+      if (prev === undefined) return -1;
+      view().setBigUint64(primary, prev, true);
+      return ctx.iterator(t, prev);
+    },
+    db_find_i64(code, scope, table, id) {
+      const ctx = getContext();
+      const t = ctx.chain.table(code, scope, table, false);
+      if (!t) return -1;
+      return t.rows.has(id) ? ctx.iterator(t, id) : ctx.end(t);
+    },
+    db_lowerbound_i64(code, scope, table, id) {
+      const ctx = getContext();
+      const t = ctx.chain.table(code, scope, table, false);
+      if (!t) return -1;
+      const key = t.rows.lower(id);
+      return key !== undefined ? ctx.iterator(t, key) : ctx.end(t);
+    },
+    db_upperbound_i64(code, scope, table, id) {
+      const ctx = getContext();
+      const t = ctx.chain.table(code, scope, table, false);
+      if (!t) return -1;
+      const key = t.rows.upper(id);
+      return key !== undefined ? ctx.iterator(t, key) : ctx.end(t);
+    },
+    db_end_i64(code, scope, table) {
+      const ctx = getContext();
+      const t = ctx.chain.table(code, scope, table, false);
+      return t ? ctx.end(t) : -1;
+    },
+
+    // idx64 secondary indexes
+    db_idx64_store(scope, table, payer, id, secondary) {
+      const ctx = getContext();
+      const ix = ctx.chain.index(ctx.receiver, scope, table, true);
+      ix.insert(view().getBigUint64(secondary, true), id);
+      ctx.chain.billableBytes += SECONDARY_ROW_OVERHEAD_BYTES;
+      ctx.chain.record(() => ix.remove(id));
+      return ctx.idxIterator(ix, id);
+    },
+    db_idx64_update(itr, payer, secondary) {
+      const ctx = getContext();
+      const { ix, pri } = ctx.idxRow(itr);
+      const old = ix.byPrimary.get(pri);
+      ix.remove(pri);
+      ix.insert(view().getBigUint64(secondary, true), pri);
+      ctx.chain.record(() => {
+        ix.remove(pri);
+        ix.insert(old, pri);
+      });
+    },
+    db_idx64_remove(itr) {
+      const ctx = getContext();
+      const { ix, pri } = ctx.idxRow(itr);
+      const sec = ix.byPrimary.get(pri);
+      ix.remove(pri);
+      ctx.chain.billableBytes -= SECONDARY_ROW_OVERHEAD_BYTES;
+      ctx.chain.record(() => ix.insert(sec, pri));
+      if (ix.entries.size === 0) ctx.chain.dropIndex(ix);
+    },
+    db_idx64_find_secondary(code, scope, table, secondary, primary) {
+      const ctx = getContext();
+      const ix = ctx.chain.index(code, scope, table, false);
+      if (!ix) return -1;
+      const sec = view().getBigUint64(secondary, true);
+      const key = ix.entries.lower(secondaryKey(sec, 0n));
+      if (key === undefined || key >> 64n !== sec) return ctx.idxEnd(ix);
+      view().setBigUint64(primary, key & KEY_MASK, true);
+      return ctx.idxIterator(ix, key & KEY_MASK);
+    },
+    db_idx64_find_primary(code, scope, table, secondary, primary) {
+      const ctx = getContext();
+      const ix = ctx.chain.index(code, scope, table, false);
+      if (!ix) return -1;
+      const sec = ix.byPrimary.get(primary);
+      if (sec === undefined) return ctx.idxEnd(ix);
+      view().setBigUint64(secondary, sec, true);
+      return ctx.idxIterator(ix, primary);
+    },
+    db_idx64_lowerbound(code, scope, table, secondary, primary) {
+      const ctx = getContext();
+      const ix = ctx.chain.index(code, scope, table, false);
+      if (!ix) return -1;
+      const key = ix.entries.lower(secondaryKey(view().getBigUint64(secondary, true), 0n));
+      if (key === undefined) return ctx.idxEnd(ix);
+      view().setBigUint64(secondary, key >> 64n, true);
+      view().setBigUint64(primary, key & KEY_MASK, true);
+      return ctx.idxIterator(ix, key & KEY_MASK);
+    },
+    db_idx64_upperbound(code, scope, table, secondary, primary) {
+      const ctx = getContext();
+      const ix = ctx.chain.index(code, scope, table, false);
+      if (!ix) return -1;
+      const key = ix.entries.upper(secondaryKey(view().getBigUint64(secondary, true), KEY_MASK));
+      if (key === undefined) return ctx.idxEnd(ix);
+      view().setBigUint64(secondary, key >> 64n, true);
+      view().setBigUint64(primary, key & KEY_MASK, true);
+      return ctx.idxIterator(ix, key & KEY_MASK);
+    },
+    db_idx64_end(code, scope, table) {
+      const ctx = getContext();
+      const ix = ctx.chain.index(code, scope, table, false);
+      return ix ? ctx.idxEnd(ix) : -1;
+    },
+    db_idx64_next(itr, primary) {
+      const ctx = getContext();
+      if (itr < -1) return -1;
+      const { ix, pri } = ctx.idxRow(itr);
+      const key = ix.entries.upper(secondaryKey(ix.byPrimary.get(pri), pri));
+      if (key === undefined) return ctx.idxEnd(ix);
+      view().setBigUint64(primary, key & KEY_MASK, true);
+      return ctx.idxIterator(ix, key & KEY_MASK);
+    },
+    db_idx64_previous(itr, primary) {
+      const ctx = getContext();
+      let ix;
+      let key;
+      if (itr < -1) {
+        ix = ctx.idxTabs[-itr - 2];
+        key = ix.entries.last();
+      } else {
+        const entry = ctx.idxRow(itr);
+        ix = entry.ix;
+        key = ix.entries.before(secondaryKey(ix.byPrimary.get(entry.pri), entry.pri));
+      }
+      if (key === undefined) return -1;
+      view().setBigUint64(primary, key & KEY_MASK, true);
+      return ctx.idxIterator(ix, key & KEY_MASK);
+    },
+  };
+
+  const imports = {};
+  for (const { module: moduleName, name, kind } of WebAssembly.Module.imports(module)) {
+    if (kind !== "function") continue;
+    imports[moduleName] = imports[moduleName] || {};
+    if (moduleName === "env" && env[name]) {
+      imports[moduleName][name] = env[name];
+    } else if (name.startsWith("print")) {
+      imports[moduleName][name] = () => {};
+    } else {
+      imports[moduleName][name] = () => {
+        throw new AssertFailure(`unsupported intrinsic ${moduleName}.${name}`);
+      };
+    }
+  }
+  return imports;
+}
+
+// runs one action against `chain`, instantiating a fresh copy of the
+// module like nodeos does, and returns the time spent in apply(). The
+// writes of an action that fails are undone before the error is rethrown.
+function runAction(module, chain, receiver, action) {
+  const ctx = new ActionContext(chain, receiver, action.data, action.auths);
+  let instance;
+  const imports = createImports(
+    module,
+    () => instance.exports.memory,
+    () => ctx
+  );
+  instance = new WebAssembly.Instance(module, imports);
+
+  chain.begin();
+  const start = process.hrtime.bigint();
+  try {
+    instance.exports.apply(receiver, receiver, action.name);
+  } catch (e) {
+    if (!(e instanceof ContractExit)) {
+      chain.rollback();
+      throw e;
+    }
+  }
+  const ns = Number(process.hrtime.bigint() - start);
+  chain.commit();
+  return { ns, returnValue: ctx.returnValue };
+}
+
+module.exports = { AssertFailure, Chain, OrderedIndex, createImports, runAction };
@@ -0,0 +1,39 @@
+// Child process entry of wasm-engines.js: replays the corpus under the V8
+// flags this process was started with and prints the raw samples as JSON.
+//
+// usage: node [engine flags] replay.js <wasm> <rounds>
+
+const fs = require("fs");
+const { Chain, runAction } = require("./host");
+const { CONTRACT, buildCorpus } = require("./corpus");
+const { nameToBigInt } = require("./serialize");
+
+const [wasmPath, rounds = "5"] = process.argv.slice(2);
+const wasmModule = new WebAssembly.Module(fs.readFileSync(wasmPath));
+const receiver = nameToBigInt(CONTRACT);
+const corpus = buildCorpus();
+
+const samples = {};
+let failures = 0;
+let firstFailure = null;
+for (let round = 0; round < Number(rounds); round++) {
+  const chain = new Chain();
+  corpus.accounts.forEach((account) => chain.accounts.add(nameToBigInt(account)));
+  corpus.setup.forEach((action) => runAction(wasmModule, chain, receiver, action));
+
+  for (const action of corpus.actions) {
+    let result;
+    try {
+      result = runAction(wasmModule, chain, receiver, action);
+    } catch (e) {
+      failures++;
+      firstFailure = firstFailure || `${action.label}: ${e.message}`;
+      continue;
+    }
+    // the first round only warms up the engine
+    if (round === 0) continue;
+    (samples[action.label] = samples[action.label] || []).push(result.ns);
+  }
+}
+
+process.stdout.write(JSON.stringify({ samples, failures, firstFailure }));
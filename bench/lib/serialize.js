@@ -0,0 +1,111 @@
+// Minimal EOSIO binary serialization for the types used by the apoc.token
+// actions, so the benchmarks can pack action data without an ABI library.
+
+const NAME_CHARS = ".12345abcdefghijklmnopqrstuvwxyz";
+
+function nameToBigInt(name) {
+  let value = 0n;
+  for (let i = 0; i <= 12; i++) {
+    const c = i < name.length ? Math.max(NAME_CHARS.indexOf(name[i]), 0) : 0;
+    if (i < 12) {
+      value |= BigInt(c & 0x1f) << BigInt(64 - 5 * (i + 1));
+    } else {
+      value |= BigInt(c & 0x0f);
+    }
+  }
+  return value;
+}
+
+function symbolToBigInt(precision, code) {
+  let value = 0n;
+  for (let i = code.length - 1; i >= 0; i--) {
+    value = (value << 8n) | BigInt(code.charCodeAt(i));
+  }
+  return (value << 8n) | BigInt(precision);
+}
+
+// parses "1.00000 APOC" into { amount, precision, code }
+function parseAsset(text) {
+  const [number, code] = text.split(" ");
+  const [whole, fraction = ""] = number.split(".");
+  const amount = BigInt(whole + fraction);
+  return { amount, precision: fraction.length, code };
+}
+
+class Writer {
+  constructor() {
+    this.chunks = [];
+  }
+
+  bytes(buffer) {
+    this.chunks.push(Buffer.from(buffer));
+    return this;
+  }
+
+  uint8(value) {
+    return this.bytes([value & 0xff]);
+  }
+
+  uint64(value) {
+    const buffer = Buffer.alloc(8);
+    buffer.writeBigUInt64LE(BigInt.asUintN(64, BigInt(value)));
+    return this.bytes(buffer);
+  }
+
+  int64(value) {
+    const buffer = Buffer.alloc(8);
+    buffer.writeBigInt64LE(BigInt(value));
+    return this.bytes(buffer);
+  }
+
+  varuint32(value) {
+    const out = [];
+    do {
+      let b = value & 0x7f;
+      value >>>= 7;
+      if (value) b |= 0x80;
+      out.push(b);
+    } while (value);
+    return this.bytes(out);
+  }
+
+  name(value) {
+    return this.uint64(nameToBigInt(value));
+  }
+
+  symbol(precision, code) {
+    return this.uint64(symbolToBigInt(precision, code));
+  }
+
+  asset(text) {
+    const { amount, precision, code } = parseAsset(text);
+    return this.int64(amount).symbol(precision, code);
+  }
+
+  string(value) {
+    const buffer = Buffer.from(value, "utf8");
+    return this.varuint32(buffer.length).bytes(buffer);
+  }
+
+  blob(buffer) {
+    return this.varuint32(buffer.length).bytes(buffer);
+  }
+
+  vector(items, writeItem) {
+    this.varuint32(items.length);
+    items.forEach((item) => writeItem(this, item));
+    return this;
+  }
+
+  toBuffer() {
+    return Buffer.concat(this.chunks);
+  }
+}
+
+const pack = (write) => {
+  const writer = new Writer();
+  write(writer);
+  return writer.toBuffer();
+};
+
+module.exports = { nameToBigInt, symbolToBigInt, parseAsset, Writer, pack };
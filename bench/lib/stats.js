@@ -0,0 +1,26 @@
+// Latency summaries, in microseconds.
+
+function percentile(sorted, p) {
+  if (sorted.length === 0) return 0;
+  const idx = Math.min(sorted.length - 1, Math.ceil((p / 100) * sorted.length) - 1);
+  return sorted[Math.max(idx, 0)];
+}
+
+function summarize(samplesNs) {
+  const sorted = Float64Array.from(samplesNs, (ns) => ns / 1e3).sort();
+  const sum = sorted.reduce((a, b) => a + b, 0);
+  return {
+    count: sorted.length,
+    mean: sorted.length ? sum / sorted.length : 0,
+    p50: percentile(sorted, 50),
+    p90: percentile(sorted, 90),
+    p99: percentile(sorted, 99),
+    max: sorted.length ? sorted[sorted.length - 1] : 0,
+  };
+}
+
+function formatRow(columns, widths) {
+  return columns.map((c, i) => String(c).padStart(widths[i])).join(" ");
+}
+
+module.exports = { percentile, summarize, formatRow };
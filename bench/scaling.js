@@ -0,0 +1,187 @@
+// Scaling study: how transfer, open and close latency and RAM grow with the
+// number of `accounts` scopes. State at each size is seeded through bulk
+// hydraload actions, or written straight into the host stub with
+// `--seed native`, which is the only practical way to reach 10^7 holders.
+// Either way every holder also gets its holder id and is counted in the
+// balance histogram, as if it had been credited through add_balance, and
+// the stat row carries their combined supply. Seeding runs on an empty
+// chain, before any action could create balances, ids or histogram rows.
+//
+// The host stub keeps tables in B+ trees keyed on (code, scope, table), so
+// lookups get deeper as holders are added; the depth column is the height
+// of that tree measured after seeding.
+//
+// usage: node [--max-old-space-size=16384] bench/scaling.js [--wasm <path>]
+//          [--sizes 1000,10000,...] [--samples <n>] [--seed hydraload|native]
+//          [--csv <path>]
+
+const fs = require("fs");
+const path = require("path");
+const { Chain, runAction } = require("./lib/host");
+const {
+  CONTRACT,
+  HISTOGRAM_BUCKETS,
+  accountName,
+  accountRow,
+  holderRow,
+  memberRow,
+  statRow,
+  histogramRow,
+  balanceBucket,
+  transfer,
+  open,
+  close,
+  hydraload,
+} = require("./lib/corpus");
+const { nameToBigInt, parseAsset } = require("./lib/serialize");
+const { summarize, formatRow } = require("./lib/stats");
+
+const SEED_BATCH = 500;
+// not a power of ten, so the sampled transfers never move a holder to
+// another histogram bucket
+const SEED_BALANCE = "123.45678 APOC";
+
+function parseArgs(argv) {
+  const args = {
+    wasm: path.join(__dirname, "..", "contracts", "apoc.token.wasm"),
+    sizes: [1e3, 1e4, 1e5, 1e6],
+    samples: 1000,
+    seed: "hydraload",
+    csv: null,
+  };
+  for (let i = 0; i < argv.length; i += 2) {
+    const value = argv[i + 1];
+    if (argv[i] === "--wasm") args.wasm = path.resolve(value);
+    else if (argv[i] === "--sizes") args.sizes = value.split(",").map(Number);
+    else if (argv[i] === "--samples") args.samples = Number(value);
+    else if (argv[i] === "--seed") args.seed = value;
+    else if (argv[i] === "--csv") args.csv = path.resolve(value);
+    else throw new Error(`unknown option ${argv[i]}`);
+  }
+  if (!["hydraload", "native"].includes(args.seed)) {
+    throw new Error(`unknown seed mode ${args.seed}`);
+  }
+  return args;
+}
+
+// each holder's balance, holder id and histogram membership rows, ids in
+// seeding order
+const holderRows = (holders, firstId) =>
+  holders.flatMap((owner, i) => [
+    accountRow(owner, SEED_BALANCE),
+    holderRow(firstId + i, owner),
+    memberRow(owner),
+  ]);
+
+// the rows every holder shares: the supply they hold and their histogram
+function tokenRows(holders) {
+  const supply = parseAsset(SEED_BALANCE).amount * BigInt(holders.length);
+  const buckets = new Array(HISTOGRAM_BUCKETS).fill(0);
+  buckets[balanceBucket(SEED_BALANCE)] = holders.length;
+  return [statRow(supply, (1n << 62n) - 1n, CONTRACT), histogramRow(buckets)];
+}
+
+// loads the token and its holders into an empty chain
+function seed(wasmModule, chain, receiver, holders, mode) {
+  if (mode === "hydraload") {
+    runAction(wasmModule, chain, receiver, hydraload(tokenRows(holders)));
+    for (let i = 0; i < holders.length; i += SEED_BATCH) {
+      runAction(wasmModule, chain, receiver, hydraload(holderRows(holders.slice(i, i + SEED_BATCH), i)));
+    }
+    return;
+  }
+
+  // the byowner index of holderids is idx64 number 0
+  const byOwner = (nameToBigInt("holderids") & ~0xfn) | 0n;
+  const store = (row) =>
+    chain.storeRow(receiver, row.scope, nameToBigInt(row.table), row.primary, receiver, row.data);
+  tokenRows(holders).forEach(store);
+  holders.forEach((owner, i) => {
+    holderRows([owner], i).forEach(store);
+    chain.storeSecondary(receiver, receiver, byOwner, BigInt(i), nameToBigInt(owner));
+  });
+}
+
+// runs `actions`, returning latency samples and the average RAM delta
+function measure(wasmModule, chain, receiver, actions) {
+  const samples = [];
+  const before = chain.billableBytes;
+  for (const action of actions) {
+    samples.push(runAction(wasmModule, chain, receiver, action).ns);
+  }
+  return { samples, ramPerAction: (chain.billableBytes - before) / actions.length };
+}
+
+// xorshift32, so every size replays the same transfer pairs
+function random(seedValue) {
+  let state = seedValue;
+  return (bound) => {
+    state ^= state << 13;
+    state ^= state >>> 17;
+    state ^= state << 5;
+    return (state >>> 0) % bound;
+  };
+}
+
+function main() {
+  const args = parseArgs(process.argv.slice(2));
+  const wasmModule = new WebAssembly.Module(fs.readFileSync(args.wasm));
+  const receiver = nameToBigInt(CONTRACT);
+
+  const columns = ["holders", "action", "count", "mean", "p50", "p90", "p99", "ram/action", "state MB", "depth"];
+  const widths = [10, 10, 7, 9, 9, 9, 9, 11, 10, 6];
+  const csv = [columns.join(",")];
+  console.log(formatRow(columns, widths));
+
+  for (const size of args.sizes) {
+    const chain = new Chain();
+    const holders = Array.from({ length: size }, (_, i) => accountName("h", i));
+    const fresh = Array.from({ length: args.samples }, (_, i) => accountName("o", i));
+    [CONTRACT, "eosio", ...holders, ...fresh].forEach((account) =>
+      chain.accounts.add(nameToBigInt(account))
+    );
+
+    seed(wasmModule, chain, receiver, holders, args.seed);
+
+    const next = random(0x2545f491);
+    const pairs = () => {
+      const from = next(size);
+      let to = next(size);
+      if (to === from) to = (from + 1) % size;
+      return transfer(holders[from], holders[to], "0.00001 APOC");
+    };
+    // warm the engine up before the first measurement at this size
+    measure(wasmModule, chain, receiver, Array.from({ length: 50 }, pairs));
+
+    const stateMb = chain.billableBytes / (1 << 20);
+    const depth = chain.tables.height;
+    const results = {
+      transfer: measure(wasmModule, chain, receiver, Array.from({ length: args.samples }, pairs)),
+      open: measure(wasmModule, chain, receiver, fresh.map(open)),
+      close: measure(wasmModule, chain, receiver, fresh.map(close)),
+    };
+
+    for (const [label, { samples, ramPerAction }] of Object.entries(results)) {
+      const s = summarize(samples);
+      const row = [
+        size,
+        label,
+        s.count,
+        s.mean.toFixed(1),
+        s.p50.toFixed(1),
+        s.p90.toFixed(1),
+        s.p99.toFixed(1),
+        ramPerAction.toFixed(1),
+        stateMb.toFixed(1),
+        depth,
+      ];
+      console.log(formatRow(row, widths));
+      csv.push(row.join(","));
+    }
+  }
+  console.log("latencies in microseconds, RAM in billable bytes");
+
+  if (args.csv) fs.writeFileSync(args.csv, csv.join("\n") + "\n");
+}
+
+main();
@@ -0,0 +1,89 @@
+// Replays a fixed action corpus (transfers, opens, closes and hydraload batch
+// loads) against the built contract under each available WASM engine and
+// reports per-action latency distributions.
+//
+// nodeos engines (eos-vm interpreter, eos-vm-jit and eos-vm-oc) cannot be
+// embedded here, so the harness uses the closest V8 execution tiers; an
+// engine whose flags the running node does not support is skipped.
+//
+// usage: node bench/wasm-engines.js [--wasm <path>] [--rounds <n>] [--engines a,b]
+
+const path = require("path");
+const { spawnSync } = require("child_process");
+const { summarize, formatRow } = require("./lib/stats");
+
+const ENGINES = {
+  // V8's wasm interpreter, only present in builds with DrumBrake
+  interpreter: ["--wasm-jitless"],
+  // baseline single-pass compiler, comparable to eos-vm-jit
+  jit: ["--liftoff", "--no-wasm-tier-up"],
+  // optimizing compiler for every function up front, comparable to eos-vm-oc
+  aot: ["--no-liftoff", "--no-wasm-lazy-compilation"],
+};
+
+function parseArgs(argv) {
+  const args = {
+    wasm: path.join(__dirname, "..", "contracts", "apoc.token.wasm"),
+    rounds: 5,
+    engines: Object.keys(ENGINES),
+  };
+  for (let i = 0; i < argv.length; i += 2) {
+    const value = argv[i + 1];
+    if (argv[i] === "--wasm") args.wasm = path.resolve(value);
+    else if (argv[i] === "--rounds") args.rounds = Number(value);
+    else if (argv[i] === "--engines") args.engines = value.split(",");
+    else throw new Error(`unknown option ${argv[i]}`);
+  }
+  return args;
+}
+
+// an engine is available if node accepts its flags and can run wasm with them
+function isAvailable(flags) {
+  const probe = spawnSync(process.execPath, [
+    ...flags,
+    "-e",
+    "new WebAssembly.Instance(new WebAssembly.Module(new Uint8Array([0,97,115,109,1,0,0,0])))",
+  ]);
+  return probe.status === 0;
+}
+
+function main() {
+  const args = parseArgs(process.argv.slice(2));
+  const widths = [12, 10, 7, 9, 9, 9, 9, 9];
+  console.log(formatRow(["engine", "action", "count", "mean", "p50", "p90", "p99", "max"], widths));
+
+  for (const engine of args.engines) {
+    const flags = ENGINES[engine];
+    if (!flags) throw new Error(`unknown engine ${engine}`);
+    if (!isAvailable(flags)) {
+      console.log(`${engine.padStart(widths[0])} unavailable in node ${process.version}`);
+      continue;
+    }
+
+    const child = spawnSync(
+      process.execPath,
+      [...flags, path.join(__dirname, "lib", "replay.js"), args.wasm, String(args.rounds)],
+      { encoding: "utf8", maxBuffer: 1 << 28 }
+    );
+    if (child.status !== 0) {
+      throw new Error(`${engine} replay failed:\n${child.stderr}`);
+    }
+
+    const { samples, failures, firstFailure } = JSON.parse(child.stdout);
+    for (const [label, ns] of Object.entries(samples)) {
+      const s = summarize(ns);
+      console.log(
+        formatRow(
+          [engine, label, s.count, s.mean.toFixed(1), s.p50.toFixed(1), s.p90.toFixed(1), s.p99.toFixed(1), s.max.toFixed(1)],
+          widths
+        )
+      );
+    }
+    if (failures > 0) {
+      console.log(`${engine.padStart(widths[0])} ${failures} failed actions, first: ${firstFailure}`);
+    }
+  }
+  console.log("latencies in microseconds");
+}
+
+main();
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <eosio/asset.hpp>
+#include <eosio/crypto.hpp>
 #include <eosio/eosio.hpp>
+#include <eosio/time.hpp>
 
 #include <string>
 
@@ -28,7 +30,16 @@ namespace eosio {
    class [[eosio::contract("apoc.token")]] token : public contract {
       public:
          using contract::contract;
-         
+
+         struct sweep_source {
+            name     from;
+            asset    quantity;
+         };
+
+         struct evicted_batch {
+            uint64_t             batch_id;
+            std::vector<asset>   balances;
+         };
 
          /**
           * Create action.
@@ -59,6 +70,47 @@ namespace eosio {
          [[eosio::action]]
          void issue( const name& to, const asset& quantity, const string& memo );
 
+         /**
+          * Set minter action.
+          *
+          * @details Allows the token issuer to grant `minter` the right to mint up to `quota` tokens.
+          * Replaces the remaining quota of an existing minter.
+          *
+          * @param minter - the account allowed to mint,
+          * @param quota - the quantity of tokens `minter` may still mint.
+          *
+          * @pre Token symbol must exist and `quota` must match its precision,
+          * @pre `quota` must not be negative.
+          */
+         [[eosio::action]]
+         void setminter( const name& minter, const asset& quota );
+
+         /**
+          * Delete minter action.
+          *
+          * @details Allows the token issuer to revoke `minter`'s right to mint token `symbol`.
+          *
+          * @param minter - the account to revoke,
+          * @param symbol - the token to revoke the minter for.
+          */
+         [[eosio::action]]
+         void delminter( const name& minter, const symbol& symbol );
+
+         /**
+          * Mint action.
+          *
+          * @details Allows `minter` to issue `quantity` tokens directly to `to`, debiting its quota.
+          *
+          * @param minter - the minter account issuing the tokens,
+          * @param to - the account to issue tokens to,
+          * @param quantity - the amount of tokens to be issued,
+          * @param memo - the memo string that accompanies the token issue transaction.
+          *
+          * @pre `quantity` must not exceed the minter's remaining quota nor the available supply.
+          */
+         [[eosio::action]]
+         void mint( const name& minter, const name& to, const asset& quantity, const string& memo );
+
          /**
           * Retire action.
           *
@@ -87,6 +139,42 @@ namespace eosio {
                         const name&    to,
                         const asset&   quantity,
                         const string&  memo );
+
+         /**
+          * Transfer with tag action.
+          *
+          * @details Same as transfer, but the free-form memo is replaced by a numeric deposit `tag`,
+          * so exchanges can attribute deposits without parsing strings.
+          *
+          * @param from - the account to transfer from,
+          * @param to - the account to be transferred to,
+          * @param quantity - the quantity of tokens to be transferred,
+          * @param tag - the deposit tag to accompany the transaction.
+          *
+          * @return the deposit tag, exposed as the action return value.
+          */
+         [[eosio::action]]
+         uint64_t transfertag( const name&    from,
+                               const name&    to,
+                               const asset&   quantity,
+                               const uint64_t tag );
+         /**
+          * Sweep action.
+          *
+          * @details Consolidates tokens from many `sources` into the single account `to`.
+          * Each source account is debited its quantity and `to` is credited once with the total.
+          *
+          * @param sources - the accounts to sweep from, each with the quantity of tokens to debit,
+          * @param to - the account to be credited,
+          * @param memo - the memo string to accompany the transaction.
+          *
+          * @pre Every source account must authorize the action,
+          * @pre All quantities must be positive and of the same token.
+          */
+         [[eosio::action]]
+         void sweep( const std::vector<sweep_source>& sources,
+                     const name&                      to,
+                     const string&                    memo );
          /**
           * Open action.
           *
@@ -116,6 +204,90 @@ namespace eosio {
          [[eosio::action]]
          void close( const name& owner, const symbol& symbol );
 
+         /**
+          * Evict action.
+          *
+          * @details Moves the dormant non-zero balances of `owners` for token `symbol` out of RAM.
+          * The balance rows are erased and only the Merkle root of the evicted balances is kept,
+          * as a new cold batch. The evicted tokens remain part of the supply.
+          * Dormancy is not tracked on chain: the contract account decides off-chain which balances
+          * are dormant, and any listed balance is evicted.
+          *
+          * @param symbol - the token to evict balances of,
+          * @param owners - the accounts whose balances are evicted, in leaf order.
+          *
+          * @return the id of the new cold batch and the evicted balances in leaf order, which together
+          * with `owners` are the leaves every holder needs to build a revive proof from the action trace.
+          *
+          * @pre Every owner must have a non-zero balance row for `symbol`.
+          */
+         [[eosio::action]]
+         evicted_batch evict( const symbol& symbol, const std::vector<name>& owners );
+
+         /**
+          * Revive action.
+          *
+          * @details Restores an evicted `balance` of `owner` from cold batch `batch_id`, given the Merkle
+          * `proof` of its leaf at `leaf_index`. The leaf is cleared from the batch root, and the balance
+          * is credited back to `owner` at the expense of `ram_payer`.
+          * `sub_balance` and `add_balance` never consult cold batches, so an evicted balance cannot be
+          * spent until it has been revived with this action.
+          *
+          * @param owner - the account whose balance is revived,
+          * @param batch_id - the cold batch the balance was evicted into,
+          * @param balance - the evicted balance,
+          * @param leaf_index - the position of `owner` in the evicted batch,
+          * @param proof - the sibling hashes from the leaf up to the batch root,
+          * @param ram_payer - the account that supports the cost of this action.
+          */
+         [[eosio::action]]
+         void revive( const name& owner, uint64_t batch_id, const asset& balance,
+                      uint64_t leaf_index, const std::vector<checksum256>& proof, const name& ram_payer );
+
+         /**
+          * Histogram backfill action.
+          *
+          * @details Counts the `sym_code` balances of `owners` in the balance histogram. Rows created
+          * before the histogram existed, or loaded without `add_balance`, are otherwise only counted
+          * from their first credit. Owners that are already counted are skipped, so batches may overlap.
+          *
+          * @param sym_code - the token whose histogram is backfilled,
+          * @param owners - the accounts whose balances are counted.
+          *
+          * @pre Every owner must have a balance row for `sym_code`.
+          */
+         [[eosio::action]]
+         void histbackfill( const symbol_code& sym_code, const std::vector<name>& owners );
+
+         /**
+          * Set permit action.
+          *
+          * @details Allows `owner` to register a `session` account that may debit up to `cap` tokens from
+          * `owner`'s balance until `expiration`, without `owner` signing each transfer.
+          * Replaces any permit previously registered by `owner`.
+          *
+          * @param owner - the account whose balance the permit spends from,
+          * @param session - the account authorized to spend on behalf of `owner`,
+          * @param cap - the maximum quantity of tokens the permit may spend,
+          * @param expiration - the time after which the permit can no longer be used.
+          *
+          * @pre `session` must be an existing account other than `owner`,
+          * @pre `cap` must be positive and match the token symbol and precision,
+          * @pre `expiration` must be in the future.
+          */
+         [[eosio::action]]
+         void setpermit( const name& owner, const name& session, const asset& cap, const time_point_sec& expiration );
+
+         /**
+          * Delete permit action.
+          *
+          * @details Revokes the spending permit registered by `owner`.
+          *
+          * @param owner - the account whose permit is revoked.
+          */
+         [[eosio::action]]
+         void delpermit( const name& owner );
+
          /**
          * Get token name action
          * returns string for token name
@@ -151,6 +323,22 @@ namespace eosio {
          [[eosio::action]]
          asset balanceof(const name & owner);
 
+         /**
+         * Get balance distribution action
+         * returns the number of holders of token `sym_code` per balance bucket,
+         * bucket 0 holding zero balances and bucket n balances in [10^(n-1), 10^n) base units;
+         * rows that predate the histogram are missing until credited or backfilled with histbackfill
+         */
+         [[eosio::action]]
+         std::vector<uint64_t> distribution( const symbol_code& sym_code );
+
+         /**
+         * Get holder id action
+         * returns the dense holder id interned for owner
+         */
+         [[eosio::action]]
+         uint32_t holderid( const name& owner );
+
          /**
           * Get supply method.
           *
@@ -183,12 +371,40 @@ namespace eosio {
             return ac.balance;
          }
 
+         /**
+          * Get holder id method.
+          *
+          * @details Gets the dense 32-bit id interned for `owner` by `token_contract_account` account,
+          * for auxiliary tables to key on instead of the 64-bit name.
+          *
+          * @param token_contract_account - the token contract account,
+          * @param owner - the account for which the holder id is returned.
+          */
+         static uint32_t get_holder_id( const name& token_contract_account, const name& owner )
+         {
+            holderids idstable( token_contract_account, token_contract_account.value );
+            auto byowner = idstable.get_index<"byowner"_n>();
+            auto it = byowner.find( owner.value );
+            check( it != byowner.end(), "holder has no id" );
+            return static_cast<uint32_t>( it->id );
+         }
+
          using create_action = eosio::action_wrapper<"create"_n, &token::create>;
          using issue_action = eosio::action_wrapper<"issue"_n, &token::issue>;
+         using setminter_action = eosio::action_wrapper<"setminter"_n, &token::setminter>;
+         using delminter_action = eosio::action_wrapper<"delminter"_n, &token::delminter>;
+         using mint_action = eosio::action_wrapper<"mint"_n, &token::mint>;
          using retire_action = eosio::action_wrapper<"retire"_n, &token::retire>;
          using transfer_action = eosio::action_wrapper<"transfer"_n, &token::transfer>;
+         using transfertag_action = eosio::action_wrapper<"transfertag"_n, &token::transfertag>;
+         using sweep_action = eosio::action_wrapper<"sweep"_n, &token::sweep>;
          using open_action = eosio::action_wrapper<"open"_n, &token::open>;
          using close_action = eosio::action_wrapper<"close"_n, &token::close>;
+         using evict_action = eosio::action_wrapper<"evict"_n, &token::evict>;
+         using revive_action = eosio::action_wrapper<"revive"_n, &token::revive>;
+         using histbackfill_action = eosio::action_wrapper<"histbackfill"_n, &token::histbackfill>;
+         using setpermit_action = eosio::action_wrapper<"setpermit"_n, &token::setpermit>;
+         using delpermit_action = eosio::action_wrapper<"delpermit"_n, &token::delpermit>;
       private:
          struct [[eosio::table]] account {
             asset    balance;
@@ -204,11 +420,103 @@ namespace eosio {
             uint64_t primary_key()const { return supply.symbol.code().raw(); }
          };
 
+         struct [[eosio::table]] permit {
+            name           owner;
+            name           session;
+            asset          remaining;
+            time_point_sec expiration;
+
+            uint64_t primary_key()const { return owner.value; }
+         };
+
+         struct [[eosio::table]] minter_quota {
+            name     minter;
+            asset    quota;
+
+            uint64_t primary_key()const { return minter.value; }
+         };
+
+         struct [[eosio::table]] cold_batch {
+            uint64_t    id;
+            checksum256 root;
+            uint64_t    leaves;
+            uint64_t    live;
+
+            uint64_t primary_key()const { return id; }
+         };
+
+         static constexpr int8_t histogram_buckets = 20;
+
+         struct [[eosio::table]] balance_histogram {
+            symbol                sym;
+            std::vector<uint64_t> holders;
+
+            uint64_t primary_key()const { return sym.code().raw(); }
+         };
+
+         struct [[eosio::table]] holder_id {
+            uint64_t id;
+            name     owner;
+
+            uint64_t primary_key()const { return id; }
+            uint64_t by_owner()const { return owner.value; }
+         };
+
+         // a balance row of `owner` counted in the histogram of the scope's symbol
+         struct [[eosio::table]] histogram_member {
+            name     owner;
+
+            uint64_t primary_key()const { return owner.value; }
+         };
+
          typedef eosio::multi_index< "accounts"_n, account > accounts;
          typedef eosio::multi_index< "stat"_n, currency_stats > stats;
+         typedef eosio::multi_index< "permits"_n, permit > permits;
+         typedef eosio::multi_index< "minters"_n, minter_quota > minters;
+         typedef eosio::multi_index< "coldbatches"_n, cold_batch > coldbatches;
+         typedef eosio::multi_index< "histogram"_n, balance_histogram > histograms;
+         typedef eosio::multi_index< "histmembers"_n, histogram_member > histmembers;
+         typedef eosio::multi_index< "holderids"_n, holder_id,
+            indexed_by< "byowner"_n, const_mem_fun< holder_id, uint64_t, &holder_id::by_owner > >
+         > holderids;
 
-         void sub_balance( const name& owner, const asset& value );
+         /**
+          * Debits `value` from `owner`. Without `owner`'s authority the debit is charged against
+          * `owner`'s spending permit instead, which requires the permit's session authority.
+          *
+          * @return the account whose authority covered the debit.
+          */
+         name sub_balance( const name& owner, const asset& value );
          void add_balance( const name& owner, const asset& value, const name& ram_payer );
+
+         /**
+          * Shared body of the transfer actions: validates `quantity` and moves it from `from` to `to`.
+          */
+         void transfer_tokens( const name& from, const name& to, const asset& quantity );
+
+         /**
+          * Assigns `owner` the next dense holder id, unless it already has one.
+          */
+         void intern_holder( const name& owner, const name& ram_payer );
+
+         /**
+          * Starts counting the `sym` balance row of `owner` in bucket `bucket` of the balance histogram,
+          * recording the row as counted at the expense of `ram_payer`.
+          */
+         void count_holder( const symbol& sym, const name& owner, int8_t bucket, const name& ram_payer );
+
+         /**
+          * Moves the counted `sym` balance row of `owner` from bucket `from_bucket` to `to_bucket` of the
+          * balance histogram, -1 standing for the row being erased. Writes nothing when the buckets are
+          * equal, or when the row was never counted.
+          */
+         void move_holder( const symbol& sym, const name& owner, int8_t from_bucket, int8_t to_bucket );
+
+         void shift_histogram( const symbol& sym, int8_t from_bucket, int8_t to_bucket );
+         static int8_t balance_bucket( int64_t amount );
+
+         static checksum256 cold_leaf( uint64_t batch_id, const name& owner, const asset& balance );
+         static checksum256 cold_parent( const checksum256& left, const checksum256& right );
       public:
          // the HYDRA_FIXTURE_ACTION macro adds the hydra action
          // to the contract and the ABI
@@ -219,6 +527,9 @@ namespace eosio {
          HYDRA_FIXTURE_ACTION(
             ((accounts)(account)(accounts))
             ((stat)(currency_stats)(stats))
+            ((holderids)(holder_id)(holderids))
+            ((histogram)(balance_histogram)(histograms))
+            ((histmembers)(histogram_member)(histmembers))
          )
    };
    /** @}*/ // end of @defgroup eosiotoken apoc
@@ -228,7 +539,7 @@ namespace eosio {
    extern "C" void apply(uint64_t receiver, uint64_t code, uint64_t action) {
       if (code == receiver) {
          HYDRA_APPLY_FIXTURE_ACTION(token)
-         switch (action) { EOSIO_DISPATCH_HELPER(token, (create)(issue)(transfer)) }
+         switch (action) { EOSIO_DISPATCH_HELPER(token, (create)(issue)(setminter)(delminter)(mint)(retire)(transfer)(transfertag)(sweep)(open)(close)(evict)(revive)(histbackfill)(setpermit)(delpermit)(tokenname)(tokensymbol)(decimals)(totalsupply)(balanceof)(distribution)(holderid)) }
       }
    }
 } /// namespace eosio
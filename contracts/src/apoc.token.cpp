@@ -1,5 +1,9 @@
 #include <apoc.token.hpp>
 
+#include <eosio/system.hpp>
+
+#include <limits>
+
 namespace eosio {
 
 void token::create( const name&   issuer,
@@ -49,6 +53,82 @@ void token::issue( const name& to, const asset& quantity, const string& memo )
     add_balance( st.issuer, quantity, st.issuer );
 }
 
+void token::setminter( const name& minter, const asset& quota )
+{
+    auto sym = quota.symbol;
+    check( sym.is_valid(), "invalid symbol name" );
+    check( is_account( minter ), "minter account does not exist" );
+
+    stats statstable( get_self(), sym.code().raw() );
+    const auto& st = statstable.get( sym.code().raw(), "token with symbol does not exist" );
+
+    require_auth( st.issuer );
+    check( quota.is_valid(), "invalid quota" );
+    check( quota.amount >= 0, "quota must not be negative" );
+    check( quota.symbol == st.supply.symbol, "symbol precision mismatch" );
+
+    minters mintertable( get_self(), sym.code().raw() );
+    auto it = mintertable.find( minter.value );
+    if( it == mintertable.end() ) {
+       mintertable.emplace( st.issuer, [&]( auto& m ) {
+          m.minter = minter;
+          m.quota  = quota;
+       });
+    } else {
+       mintertable.modify( it, same_payer, [&]( auto& m ) {
+          m.quota = quota;
+       });
+    }
+}
+
+void token::delminter( const name& minter, const symbol& symbol )
+{
+    stats statstable( get_self(), symbol.code().raw() );
+    const auto& st = statstable.get( symbol.code().raw(), "token with symbol does not exist" );
+
+    require_auth( st.issuer );
+
+    minters mintertable( get_self(), symbol.code().raw() );
+    auto it = mintertable.find( minter.value );
+    check( it != mintertable.end(), "Minter already deleted or never existed. Action won't have any effect." );
+    mintertable.erase( it );
+}
+
+void token::mint( const name& minter, const name& to, const asset& quantity, const string& memo )
+{
+    require_auth( minter );
+    check( is_account( to ), "to account does not exist" );
+
+    auto sym = quantity.symbol;
+    check( sym.is_valid(), "invalid symbol name" );
+    check( memo.size() <= 256, "memo has more than 256 bytes" );
+
+    stats statstable( get_self(), sym.code().raw() );
+    auto existing = statstable.find( sym.code().raw() );
+    check( existing != statstable.end(), "token with symbol does not exist, create token before mint" );
+    const auto& st = *existing;
+
+    minters mintertable( get_self(), sym.code().raw() );
+    const auto& mq = mintertable.get( minter.value, "account is not a minter for this token" );
+
+    check( quantity.is_valid(), "invalid quantity" );
+    check( quantity.amount > 0, "must mint positive quantity" );
+    check( quantity.symbol == st.supply.symbol, "symbol precision mismatch" );
+    check( quantity.amount <= mq.quota.amount, "quantity exceeds minter quota" );
+    check( quantity.amount <= st.max_supply.amount - st.supply.amount, "quantity exceeds available supply");
+
+    statstable.modify( st, same_payer, [&]( auto& s ) {
+       s.supply += quantity;
+    });
+    mintertable.modify( mq, same_payer, [&]( auto& m ) {
+       m.quota -= quantity;
+    });
+
+    require_recipient( to );
+
+    add_balance( to, quantity, minter );
+}
+
 void token::retire( const asset& quantity, const string& memo )
 {
     auto sym = quantity.symbol;
@@ -77,9 +157,23 @@ void token::transfer( const name&    from,
                       const name&    to,
                       const asset&   quantity,
                       const string&  memo )
+{
+    check( memo.size() <= 256, "memo has more than 256 bytes" );
+    transfer_tokens( from, to, quantity );
+}
+
+uint64_t token::transfertag( const name&    from,
+                             const name&    to,
+                             const asset&   quantity,
+                             const uint64_t tag )
+{
+    transfer_tokens( from, to, quantity );
+    return tag;
+}
+
+void token::transfer_tokens( const name& from, const name& to, const asset& quantity )
 {
     check( from != to, "cannot transfer to self" );
-    require_auth( from );
     check( is_account( to ), "to account does not exist");
     auto sym = quantity.symbol.code();
     stats statstable( get_self(), sym.raw() );
@@ -91,23 +185,78 @@ void token::transfer( const name&    from,
     check( quantity.is_valid(), "invalid quantity" );
     check( quantity.amount > 0, "must transfer positive quantity" );
     check( quantity.symbol == st.supply.symbol, "symbol precision mismatch" );
-    check( memo.size() <= 256, "memo has more than 256 bytes" );
 
-    auto payer = has_auth( to ) ? to : from;
+    // sub_balance enforces the authority of `from` or of its spending permit
+    auto spender = sub_balance( from, quantity );
+    auto payer = has_auth( to ) ? to : spender;
 
-    sub_balance( from, quantity );
     add_balance( to, quantity, payer );
 }
 
-void token::sub_balance( const name& owner, const asset& value ) {
+void token::sweep( const std::vector<sweep_source>& sources,
+                   const name&                      to,
+                   const string&                    memo )
+{
+    check( !sources.empty(), "no sources to sweep" );
+    check( is_account( to ), "to account does not exist");
+    auto sym = sources.front().quantity.symbol.code();
+    stats statstable( get_self(), sym.raw() );
+    const auto& st = statstable.get( sym.raw() );
+
+    check( memo.size() <= 256, "memo has more than 256 bytes" );
+
+    require_recipient( to );
+
+    asset total( 0, st.supply.symbol );
+    for( const auto& source : sources ) {
+       check( source.from != to, "cannot sweep to self" );
+       require_auth( source.from );
+       require_recipient( source.from );
+
+       check( source.quantity.is_valid(), "invalid quantity" );
+       check( source.quantity.amount > 0, "must sweep positive quantity" );
+       check( source.quantity.symbol == st.supply.symbol, "symbol precision mismatch" );
+
+       sub_balance( source.from, source.quantity );
+       total += source.quantity;
+    }
+
+    auto payer = has_auth( to ) ? to : sources.front().from;
+
+    add_balance( to, total, payer );
+}
+
+name token::sub_balance( const name& owner, const asset& value ) {
    accounts from_acnts( get_self(), owner.value );
 
    const auto& from = from_acnts.get( value.symbol.code().raw(), "no balance object found" );
    check( from.balance.amount >= value.amount, "overdrawn balance" );
 
-   from_acnts.modify( from, owner, [&]( auto& a ) {
+   move_holder( value.symbol, owner, balance_bucket( from.balance.amount ), balance_bucket( from.balance.amount - value.amount ) );
+
+   if( has_auth( owner ) ) {
+      from_acnts.modify( from, owner, [&]( auto& a ) {
+            a.balance -= value;
+         });
+      return owner;
+   }
+
+   permits permittable( get_self(), get_self().value );
+   auto p = permittable.find( owner.value );
+   // without a permit only `owner` may spend, and has_auth already ruled that out
+   check( p != permittable.end(), "missing authority of " + owner.to_string() );
+   require_auth( p->session );
+   check( p->expiration > current_time_point(), "spending permit has expired" );
+   check( p->remaining.symbol == value.symbol, "spending permit symbol mismatch" );
+   check( p->remaining.amount >= value.amount, "spending permit cap exceeded" );
+
+   permittable.modify( p, same_payer, [&]( auto& r ) {
+         r.remaining -= value;
+      });
+   from_acnts.modify( from, same_payer, [&]( auto& a ) {
          a.balance -= value;
       });
+   return p->session;
 }
 
 void token::add_balance( const name& owner, const asset& value, const name& ram_payer )
@@ -115,16 +264,221 @@ void token::add_balance( const name& owner, const asset& value, const name& ram_
    accounts to_acnts( get_self(), owner.value );
    auto to = to_acnts.find( value.symbol.code().raw() );
    if( to == to_acnts.end() ) {
+      intern_holder( owner, ram_payer );
+      count_holder( value.symbol, owner, balance_bucket( value.amount ), ram_payer );
       to_acnts.emplace( ram_payer, [&]( auto& a ){
         a.balance = value;
       });
    } else {
+      // rows loaded without add_balance, such as fixtures, get their id and are counted
+      // in the histogram on their first credit
+      intern_holder( owner, ram_payer );
+      histmembers members( get_self(), value.symbol.code().raw() );
+      if( members.find( owner.value ) == members.end() ) {
+         count_holder( value.symbol, owner, balance_bucket( to->balance.amount + value.amount ), ram_payer );
+      } else {
+         move_holder( value.symbol, owner, balance_bucket( to->balance.amount ), balance_bucket( to->balance.amount + value.amount ) );
+      }
       to_acnts.modify( to, same_payer, [&]( auto& a ) {
         a.balance += value;
       });
    }
 }
 
+void token::intern_holder( const name& owner, const name& ram_payer )
+{
+   holderids idstable( get_self(), get_self().value );
+   auto byowner = idstable.get_index<"byowner"_n>();
+   if( byowner.find( owner.value ) != byowner.end() ) {
+      return;
+   }
+
+   const auto id = idstable.available_primary_key();
+   check( id <= std::numeric_limits<uint32_t>::max(), "holder id space exhausted" );
+   idstable.emplace( ram_payer, [&]( auto& h ) {
+      h.id    = id;
+      h.owner = owner;
+   });
+}
+
+int8_t token::balance_bucket( int64_t amount )
+{
+   int8_t bucket = 0;
+   for( ; amount > 0; amount /= 10 ) {
+      ++bucket;
+   }
+   return bucket;
+}
+
+void token::count_holder( const symbol& sym, const name& owner, int8_t bucket, const name& ram_payer )
+{
+   histmembers members( get_self(), sym.code().raw() );
+   members.emplace( ram_payer, [&]( auto& m ) {
+      m.owner = owner;
+   });
+   shift_histogram( sym, -1, bucket );
+}
+
+void token::move_holder( const symbol& sym, const name& owner, int8_t from_bucket, int8_t to_bucket )
+{
+   if( from_bucket == to_bucket ) {
+      return;
+   }
+   // rows loaded without add_balance are not counted until credited or backfilled
+   histmembers members( get_self(), sym.code().raw() );
+   auto m = members.find( owner.value );
+   if( m == members.end() ) {
+      return;
+   }
+   if( to_bucket < 0 ) {
+      members.erase( m );
+   }
+   shift_histogram( sym, from_bucket, to_bucket );
+}
+
+void token::shift_histogram( const symbol& sym, int8_t from_bucket, int8_t to_bucket )
+{
+   histograms histtable( get_self(), sym.code().raw() );
+   auto it = histtable.find( sym.code().raw() );
+   if( it == histtable.end() ) {
+      it = histtable.emplace( get_self(), [&]( auto& h ) {
+        h.sym = sym;
+        h.holders.resize( histogram_buckets );
+      });
+   }
+   histtable.modify( it, same_payer, [&]( auto& h ) {
+     if( from_bucket >= 0 ) {
+        check( h.holders[from_bucket] > 0, "balance histogram is out of sync" );
+        --h.holders[from_bucket];
+     }
+     if( to_bucket >= 0 ) {
+        ++h.holders[to_bucket];
+     }
+   });
+}
+
+checksum256 token::cold_leaf( uint64_t batch_id, const name& owner, const asset& balance )
+{
+   auto data = pack( std::make_tuple( batch_id, owner, balance ) );
+   return sha256( data.data(), data.size() );
+}
+
+checksum256 token::cold_parent( const checksum256& left, const checksum256& right )
+{
+   std::array<uint8_t, 64> data;
+   auto l = left.extract_as_byte_array();
+   auto r = right.extract_as_byte_array();
+   std::copy( l.begin(), l.end(), data.begin() );
+   std::copy( r.begin(), r.end(), data.begin() + 32 );
+   return sha256( reinterpret_cast<const char*>( data.data() ), data.size() );
+}
+
+token::evicted_batch token::evict( const symbol& symbol, const std::vector<name>& owners )
+{
+   require_auth( get_self() );
+   check( !owners.empty(), "no owners to evict" );
+
+   auto sym_code_raw = symbol.code().raw();
+   stats statstable( get_self(), sym_code_raw );
+   const auto& st = statstable.get( sym_code_raw, "symbol does not exist" );
+   check( st.supply.symbol == symbol, "symbol precision mismatch" );
+
+   coldbatches batches( get_self(), sym_code_raw );
+   const auto batch_id = batches.available_primary_key();
+
+   evicted_batch evicted{ batch_id };
+   evicted.balances.reserve( owners.size() );
+   std::vector<checksum256> level;
+   level.reserve( owners.size() );
+   for( const auto& owner : owners ) {
+      accounts acnts( get_self(), owner.value );
+      const auto& ac = acnts.get( sym_code_raw, "no balance object found" );
+      check( ac.balance.amount > 0, "cannot evict a zero balance" );
+      level.push_back( cold_leaf( batch_id, owner, ac.balance ) );
+      evicted.balances.push_back( ac.balance );
+      move_holder( symbol, owner, balance_bucket( ac.balance.amount ), -1 );
+      acnts.erase( ac );
+   }
+
+   // odd nodes are carried up to the next level unhashed
+   while( level.size() > 1 ) {
+      for( size_t i = 0; i < level.size(); i += 2 ) {
+         level[i / 2] = i + 1 < level.size() ? cold_parent( level[i], level[i + 1] ) : level[i];
+      }
+      level.resize( ( level.size() + 1 ) / 2 );
+   }
+
+   batches.emplace( get_self(), [&]( auto& b ) {
+      b.id     = batch_id;
+      b.root   = level.front();
+      b.leaves = owners.size();
+      b.live   = owners.size();
+   });
+   return evicted;
+}
+
+void token::revive( const name& owner, uint64_t batch_id, const asset& balance,
+                    uint64_t leaf_index, const std::vector<checksum256>& proof, const name& ram_payer )
+{
+   require_auth( ram_payer );
+
+   coldbatches batches( get_self(), balance.symbol.code().raw() );
+   const auto& b = batches.get( batch_id, "cold batch does not exist" );
+   check( leaf_index < b.leaves, "leaf index out of range" );
+
+   // walk the proof once, recomputing the root for both the claimed leaf
+   // and the cleared leaf that replaces it
+   auto node    = cold_leaf( batch_id, owner, balance );
+   auto cleared = checksum256();
+   auto index   = leaf_index;
+   auto width   = b.leaves;
+   size_t p     = 0;
+   while( width > 1 ) {
+      if( index % 2 == 1 ) {
+         check( p < proof.size(), "invalid cold balance proof" );
+         node    = cold_parent( proof[p], node );
+         cleared = cold_parent( proof[p], cleared );
+         ++p;
+      } else if( index + 1 < width ) {
+         check( p < proof.size(), "invalid cold balance proof" );
+         node    = cold_parent( node, proof[p] );
+         cleared = cold_parent( cleared, proof[p] );
+         ++p;
+      }
+      index /= 2;
+      width = ( width + 1 ) / 2;
+   }
+   check( p == proof.size() && node == b.root, "invalid cold balance proof" );
+
+   if( b.live == 1 ) {
+      batches.erase( b );
+   } else {
+      batches.modify( b, same_payer, [&]( auto& r ) {
+         r.root = cleared;
+         r.live -= 1;
+      });
+   }
+
+   add_balance( owner, balance, ram_payer );
+}
+
+void token::histbackfill( const symbol_code& sym_code, const std::vector<name>& owners )
+{
+   require_auth( get_self() );
+
+   stats statstable( get_self(), sym_code.raw() );
+   const auto& st = statstable.get( sym_code.raw(), "symbol does not exist" );
+
+   histmembers members( get_self(), sym_code.raw() );
+   for( const auto& owner : owners ) {
+      accounts acnts( get_self(), owner.value );
+      const auto& ac = acnts.get( sym_code.raw(), "no balance object found" );
+      if( members.find( owner.value ) == members.end() ) {
+         count_holder( st.supply.symbol, owner, balance_bucket( ac.balance.amount ), get_self() );
+      }
+   }
+}
+
 void token::open( const name& owner, const symbol& symbol, const name& ram_payer )
 {
    require_auth( ram_payer );
@@ -139,6 +493,8 @@ void token::open( const name& owner, const symbol& symbol, const name& ram_payer
    accounts acnts( get_self(), owner.value );
    auto it = acnts.find( sym_code_raw );
    if( it == acnts.end() ) {
+      intern_holder( owner, ram_payer );
+      count_holder( symbol, owner, 0, ram_payer );
       acnts.emplace( ram_payer, [&]( auto& a ){
         a.balance = asset{0, symbol};
       });
@@ -152,9 +508,52 @@ void token::close( const name& owner, const symbol& symbol )
    auto it = acnts.find( symbol.code().raw() );
    check( it != acnts.end(), "Balance row already deleted or never existed. Action won't have any effect." );
    check( it->balance.amount == 0, "Cannot close because the balance is not zero." );
+   move_holder( it->balance.symbol, owner, 0, -1 );
    acnts.erase( it );
 }
 
+void token::setpermit( const name& owner, const name& session, const asset& cap, const time_point_sec& expiration )
+{
+   require_auth( owner );
+
+   check( session != owner, "cannot grant a permit to self" );
+   check( is_account( session ), "session account does not exist" );
+
+   auto sym_code_raw = cap.symbol.code().raw();
+   stats statstable( get_self(), sym_code_raw );
+   const auto& st = statstable.get( sym_code_raw, "symbol does not exist" );
+   check( cap.is_valid(), "invalid cap" );
+   check( cap.amount > 0, "cap must be positive" );
+   check( cap.symbol == st.supply.symbol, "symbol precision mismatch" );
+   check( expiration > current_time_point(), "expiration must be in the future" );
+
+   permits permittable( get_self(), get_self().value );
+   auto it = permittable.find( owner.value );
+   if( it == permittable.end() ) {
+      permittable.emplace( owner, [&]( auto& p ){
+        p.owner      = owner;
+        p.session    = session;
+        p.remaining  = cap;
+        p.expiration = expiration;
+      });
+   } else {
+      permittable.modify( it, owner, [&]( auto& p ) {
+        p.session    = session;
+        p.remaining  = cap;
+        p.expiration = expiration;
+      });
+   }
+}
+
+void token::delpermit( const name& owner )
+{
+   require_auth( owner );
+   permits permittable( get_self(), get_self().value );
+   auto it = permittable.find( owner.value );
+   check( it != permittable.end(), "Permit already deleted or never existed. Action won't have any effect." );
+   permittable.erase( it );
+}
+
 std::string token::tokenname()
 {
    return "Apocalypseium";
@@ -184,4 +583,19 @@ asset token::balanceof(const name & owner)
    return get_balance( contract_address, owner, sym_code);
 }
 
+std::vector<uint64_t> token::distribution( const symbol_code& sym_code )
+{
+   histograms histtable( get_self(), sym_code.raw() );
+   auto it = histtable.find( sym_code.raw() );
+   if( it == histtable.end() ) {
+      return std::vector<uint64_t>( histogram_buckets, 0 );
+   }
+   return it->holders;
+}
+
+uint32_t token::holderid( const name& owner )
+{
+   return get_holder_id( get_self(), owner );
+}
+
 } /// namespace eosio
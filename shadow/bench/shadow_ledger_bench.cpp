@@ -0,0 +1,119 @@
+#include <shadow_ledger.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+using namespace shadow;
+
+namespace {
+
+   // dense, valid account names: s + base-31 digits
+   name account_name( uint64_t index ) {
+      static const char* chars = "abcdefghijklmnopqrstuvwxyz12345";
+      std::string str;
+      do {
+         str.insert( str.begin(), chars[index % 31] );
+         index /= 31;
+      } while( index > 0 );
+      return name( "s" + str );
+   }
+
+   struct xorshift {
+      uint64_t state;
+      uint64_t next() {
+         state ^= state << 13;
+         state ^= state >> 7;
+         state ^= state << 17;
+         return state;
+      }
+   };
+
+} /// anonymous namespace
+
+int main( int argc, char** argv ) {
+   const uint64_t accounts    = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : 100000;
+   const uint64_t moves       = argc > 2 ? std::strtoull( argv[2], nullptr, 10 ) : 1000000;
+   const unsigned max_threads = argc > 3 ? std::atoi( argv[3] ) : std::max( 1u, std::thread::hardware_concurrency() ) * 2;
+   const unsigned interval_ms = argc > 4 ? std::atoi( argv[4] ) : 10;
+
+   const symbol apoc( "APOC", 5 );
+   const asset  initial{ 1000 * 100000, apoc };
+   const asset  quantity{ 1, apoc };
+
+   std::vector<name> names;
+   names.reserve( accounts );
+   for( uint64_t i = 0; i < accounts; ++i ) {
+      names.push_back( account_name( i ) );
+   }
+
+   std::printf( "%8s %14s %14s %10s %12s %12s\n", "threads", "moves", "moves/s", "nettings", "transfers", "net ms" );
+   for( unsigned threads = 1; threads <= max_threads; threads *= 2 ) {
+      ledger l( apoc, 64, accounts / 64 * 2 + 16 );
+      for( const auto& n : names ) {
+         l.load( n, initial );
+      }
+
+      // nets every `interval_ms` while the workers keep moving, as the on-chain settlement would
+      std::unordered_map<uint64_t, int64_t> netted;
+      size_t nettings = 0, transfers = 0;
+      double net_ms = 0;
+      const auto net = [&]() {
+         const auto begin = std::chrono::steady_clock::now();
+         const auto batch = l.net();
+         net_ms += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - begin ).count();
+         ++nettings;
+         transfers += batch.size();
+         for( const auto& t : batch ) {
+            netted[t.from.value] -= t.quantity.amount;
+            netted[t.to.value]   += t.quantity.amount;
+         }
+      };
+
+      std::atomic<bool> done{ false };
+      std::vector<std::thread> workers;
+      const auto start = std::chrono::steady_clock::now();
+      for( unsigned t = 0; t < threads; ++t ) {
+         workers.emplace_back( [&, t]() {
+            xorshift rng{ 0x9e3779b97f4a7c15ULL * ( t + 1 ) };
+            for( uint64_t i = 0; i < moves; ++i ) {
+               const auto& from = names[rng.next() % accounts];
+               const auto& to   = names[rng.next() % accounts];
+               if( from == to ) continue;
+               l.move( from, to, quantity );
+            }
+         });
+      }
+      std::thread netter( [&]() {
+         while( !done.load() ) {
+            std::this_thread::sleep_for( std::chrono::milliseconds( interval_ms ) );
+            net();
+         }
+      });
+      for( auto& w : workers ) {
+         w.join();
+      }
+      const auto moved = std::chrono::steady_clock::now();
+      done.store( true );
+      netter.join();
+      net();
+
+      // every netted transfer applied to the loaded balances must reproduce the live ones
+      for( const auto& n : names ) {
+         if( l.balance( n ).amount != initial.amount + netted[n.value] ) {
+            std::fprintf( stderr, "netting of %s does not reproduce its balance\n", n.to_string().c_str() );
+            return 1;
+         }
+      }
+
+      const double seconds = std::chrono::duration<double>( moved - start ).count();
+      std::printf( "%8u %14llu %14.0f %10zu %12zu %12.1f\n", threads,
+                   static_cast<unsigned long long>( moves * threads ),
+                   moves * threads / seconds, nettings, transfers, net_ms / nettings );
+   }
+   return 0;
+}
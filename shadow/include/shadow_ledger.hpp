@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace shadow {
+
+   /**
+    * @defgroup shadowledger shadow ledger
+    *
+    * Off-chain mirror of the apoc.token balances.
+    *
+    * @details The shadow ledger moves tokens between accounts in memory, applying the same rules as the
+    * contract's `sub_balance`/`add_balance` (symbol and precision, positive quantities, overdraw), and
+    * periodically nets the accumulated movements into a small set of on-chain transfers.
+    * @{
+    */
+
+   /// Thrown when an operation violates a rule the contract would enforce with `check`.
+   struct check_failure : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   inline void check( bool pred, const char* msg ) {
+      if( !pred ) {
+         throw check_failure( msg );
+      }
+   }
+
+   /// EOSIO account name, encoded the same way as `eosio::name`.
+   struct name {
+      uint64_t value = 0;
+
+      constexpr name() = default;
+      constexpr explicit name( uint64_t v ) : value( v ) {}
+      explicit name( const std::string& str );
+
+      std::string to_string()const;
+
+      friend bool operator==( const name& a, const name& b ) { return a.value == b.value; }
+      friend bool operator!=( const name& a, const name& b ) { return a.value != b.value; }
+   };
+
+   /// EOSIO token symbol: precision plus up to 7 upper-case letters.
+   struct symbol {
+      uint64_t value = 0;
+
+      constexpr symbol() = default;
+      symbol( const std::string& code, uint8_t precision );
+
+      uint8_t     precision()const { return value & 0xff; }
+      std::string code()const;
+
+      friend bool operator==( const symbol& a, const symbol& b ) { return a.value == b.value; }
+      friend bool operator!=( const symbol& a, const symbol& b ) { return a.value != b.value; }
+   };
+
+   struct asset {
+      static constexpr int64_t max_amount = ( 1LL << 62 ) - 1;
+
+      int64_t amount = 0;
+      symbol  sym;
+
+      bool        is_valid()const { return -max_amount <= amount && amount <= max_amount; }
+      std::string to_string()const;
+   };
+
+   /// An on-chain `transfer` produced by netting.
+   struct transfer {
+      name  from;
+      name  to;
+      asset quantity;
+   };
+
+   class ledger {
+      public:
+         /**
+          * @param sym - the token symbol and precision every quantity must match,
+          * @param shard_count - the number of independent account shards,
+          * @param shard_capacity - the number of accounts each shard can hold.
+          */
+         ledger( const symbol& sym, size_t shard_count, size_t shard_capacity );
+
+         /**
+          * Seeds `owner` with its on-chain `balance`, which becomes the netting baseline.
+          *
+          * @pre Must not run concurrently with `move` or `net`: the balance and baseline are written
+          * separately, so a concurrent `move` would be lost from the next netting.
+          */
+         void load( const name& owner, const asset& balance );
+
+         /**
+          * Moves `quantity` from `from` to `to`. Lock-free and safe to call from any number of threads;
+          * only waits while `net` is snapshotting.
+          *
+          * @pre `from` must hold at least `quantity`, as `sub_balance` requires.
+          */
+         void move( const name& from, const name& to, const asset& quantity );
+
+         /// Current balance of `owner`, zero if `owner` has never held tokens.
+         asset balance( const name& owner )const;
+
+         /**
+          * Nets all movements since the previous netting into on-chain transfers and makes the
+          * current balances the new baseline.
+          *
+          * @details Debtors are matched against creditors largest first, which yields at most
+          * one transfer fewer than the number of accounts whose balance changed. Finding the true
+          * minimum is NP-hard and not attempted.
+          *
+          * Safe to call while other threads `move`: new moves are held back and in-flight ones are
+          * drained before the snapshot, and released once the new baseline is in place.
+          */
+         std::vector<transfer> net();
+
+         size_t size()const;
+
+      private:
+         struct alignas(64) slot {
+            std::atomic<uint64_t> owner{ 0 };
+            std::atomic<int64_t>  balance{ 0 };
+            int64_t               baseline = 0;
+         };
+
+         struct shard {
+            std::unique_ptr<slot[]> slots;
+            size_t                  capacity = 0;
+         };
+
+         // counts `move` calls in flight, which `net` drains after pausing new ones
+         class move_guard {
+            public:
+               explicit move_guard( ledger& l );
+               ~move_guard();
+            private:
+               ledger& _l;
+         };
+
+         slot* find( const name& owner )const;
+         slot& find_or_insert( const name& owner );
+
+         void sub_balance( slot& from, int64_t amount );
+         void add_balance( slot& to, int64_t amount );
+
+         symbol                _sym;
+         std::vector<shard>    _shards;
+         std::atomic<uint64_t> _in_flight{ 0 };
+         std::atomic<bool>     _paused{ false };
+         std::mutex            _net_mutex;
+   };
+
+   /** @}*/ // end of @defgroup shadowledger
+
+} /// namespace shadow
@@ -0,0 +1,268 @@
+#include <shadow_ledger.hpp>
+
+#include <algorithm>
+#include <thread>
+
+namespace shadow {
+
+namespace {
+
+   uint64_t char_to_value( char c ) {
+      if( c == '.' ) return 0;
+      if( c >= '1' && c <= '5' ) return ( c - '1' ) + 1;
+      if( c >= 'a' && c <= 'z' ) return ( c - 'a' ) + 6;
+      throw check_failure( "character is not in allowed character set for names" );
+   }
+
+   // splitmix64 finalizer, spreads sequential names over shards and slots
+   uint64_t mix( uint64_t x ) {
+      x ^= x >> 30;
+      x *= 0xbf58476d1ce4e5b9ULL;
+      x ^= x >> 27;
+      x *= 0x94d049bb133111ebULL;
+      x ^= x >> 31;
+      return x;
+   }
+
+} /// anonymous namespace
+
+name::name( const std::string& str ) {
+   check( str.size() <= 13, "string is too long to be a valid name" );
+   for( size_t i = 0; i < str.size() && i < 12; ++i ) {
+      value |= ( char_to_value( str[i] ) & 0x1f ) << ( 64 - 5 * ( i + 1 ) );
+   }
+   if( str.size() == 13 ) {
+      const auto v = char_to_value( str[12] );
+      check( v <= 0x0f, "thirteenth character in name cannot be a letter that comes after j" );
+      value |= v;
+   }
+}
+
+std::string name::to_string()const {
+   static const char* charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+   std::string str( 13, '.' );
+   uint64_t tmp = value;
+   for( int i = 0; i <= 12; ++i ) {
+      const char c = charmap[tmp & ( i == 0 ? 0x0f : 0x1f )];
+      str[12 - i] = c;
+      tmp >>= ( i == 0 ? 4 : 5 );
+   }
+   str.erase( str.find_last_not_of( '.' ) + 1 );
+   return str;
+}
+
+symbol::symbol( const std::string& code, uint8_t precision ) {
+   check( !code.empty() && code.size() <= 7, "invalid symbol name" );
+   for( auto it = code.rbegin(); it != code.rend(); ++it ) {
+      check( *it >= 'A' && *it <= 'Z', "invalid symbol name" );
+      value = ( value << 8 ) | static_cast<uint8_t>( *it );
+   }
+   value = ( value << 8 ) | precision;
+}
+
+std::string symbol::code()const {
+   std::string str;
+   for( uint64_t v = value >> 8; v > 0; v >>= 8 ) {
+      str.push_back( static_cast<char>( v & 0xff ) );
+   }
+   return str;
+}
+
+std::string asset::to_string()const {
+   const auto precision = sym.precision();
+   std::string digits = std::to_string( amount < 0 ? -static_cast<uint64_t>( amount ) : amount );
+   if( digits.size() <= precision ) {
+      digits.insert( 0, precision - digits.size() + 1, '0' );
+   }
+   if( precision > 0 ) {
+      digits.insert( digits.size() - precision, 1, '.' );
+   }
+   return ( amount < 0 ? "-" : "" ) + digits + " " + sym.code();
+}
+
+ledger::ledger( const symbol& sym, size_t shard_count, size_t shard_capacity )
+:_sym( sym ), _shards( shard_count )
+{
+   check( shard_count > 0 && shard_capacity > 0, "shadow ledger needs at least one slot" );
+   for( auto& s : _shards ) {
+      s.slots.reset( new slot[shard_capacity] );
+      s.capacity = shard_capacity;
+   }
+}
+
+ledger::move_guard::move_guard( ledger& l )
+:_l( l )
+{
+   // announce the move before checking for a pause, so net() either sees it in flight
+   // or this move sees the pause and backs off
+   for( ;; ) {
+      _l._in_flight.fetch_add( 1 );
+      if( !_l._paused.load() ) return;
+      _l._in_flight.fetch_sub( 1 );
+      while( _l._paused.load( std::memory_order_relaxed ) ) {
+         std::this_thread::yield();
+      }
+   }
+}
+
+ledger::move_guard::~move_guard() {
+   _l._in_flight.fetch_sub( 1, std::memory_order_release );
+}
+
+ledger::slot* ledger::find( const name& owner )const {
+   const auto h = mix( owner.value );
+   const auto& s = _shards[h % _shards.size()];
+   auto idx = ( h / _shards.size() ) % s.capacity;
+   for( size_t probes = 0; probes < s.capacity; ++probes ) {
+      auto& sl = s.slots[idx];
+      const auto key = sl.owner.load( std::memory_order_acquire );
+      if( key == owner.value ) return &sl;
+      if( key == 0 ) return nullptr;
+      idx = idx + 1 == s.capacity ? 0 : idx + 1;
+   }
+   return nullptr;
+}
+
+ledger::slot& ledger::find_or_insert( const name& owner ) {
+   check( owner.value != 0, "invalid account name" );
+   const auto h = mix( owner.value );
+   auto& s = _shards[h % _shards.size()];
+   auto idx = ( h / _shards.size() ) % s.capacity;
+   for( size_t probes = 0; probes < s.capacity; ++probes ) {
+      auto& sl = s.slots[idx];
+      auto key = sl.owner.load( std::memory_order_acquire );
+      // claim an empty slot; on a lost race `key` holds the winner's name
+      if( key == 0 && sl.owner.compare_exchange_strong( key, owner.value, std::memory_order_acq_rel ) ) {
+         return sl;
+      }
+      if( key == owner.value ) return sl;
+      idx = idx + 1 == s.capacity ? 0 : idx + 1;
+   }
+   throw check_failure( "shadow ledger shard is full" );
+}
+
+void ledger::sub_balance( slot& from, int64_t amount ) {
+   auto cur = from.balance.load( std::memory_order_relaxed );
+   do {
+      check( cur >= amount, "overdrawn balance" );
+   } while( !from.balance.compare_exchange_weak( cur, cur - amount, std::memory_order_acq_rel ) );
+}
+
+void ledger::add_balance( slot& to, int64_t amount ) {
+   auto cur = to.balance.load( std::memory_order_relaxed );
+   do {
+      check( cur <= asset::max_amount - amount, "addition overflow" );
+   } while( !to.balance.compare_exchange_weak( cur, cur + amount, std::memory_order_acq_rel ) );
+}
+
+void ledger::load( const name& owner, const asset& balance ) {
+   check( balance.is_valid(), "invalid quantity" );
+   check( balance.amount >= 0, "balance must not be negative" );
+   check( balance.sym == _sym, "symbol precision mismatch" );
+
+   auto& sl = find_or_insert( owner );
+   sl.balance.store( balance.amount, std::memory_order_release );
+   sl.baseline = balance.amount;
+}
+
+void ledger::move( const name& from, const name& to, const asset& quantity ) {
+   check( from != to, "cannot transfer to self" );
+   check( quantity.is_valid(), "invalid quantity" );
+   check( quantity.amount > 0, "must transfer positive quantity" );
+   check( quantity.sym == _sym, "symbol precision mismatch" );
+
+   move_guard guard( *this );
+   auto* src = find( from );
+   check( src != nullptr, "no balance object found" );
+   auto& dst = find_or_insert( to );
+
+   sub_balance( *src, quantity.amount );
+   try {
+      add_balance( dst, quantity.amount );
+   } catch( ... ) {
+      // restore the debit through the same checked path
+      add_balance( *src, quantity.amount );
+      throw;
+   }
+}
+
+asset ledger::balance( const name& owner )const {
+   const auto* sl = find( owner );
+   return asset{ sl ? sl->balance.load( std::memory_order_acquire ) : 0, _sym };
+}
+
+size_t ledger::size()const {
+   size_t count = 0;
+   for( const auto& s : _shards ) {
+      for( size_t i = 0; i < s.capacity; ++i ) {
+         if( s.slots[i].owner.load( std::memory_order_relaxed ) != 0 ) ++count;
+      }
+   }
+   return count;
+}
+
+std::vector<transfer> ledger::net() {
+   struct balance_change {
+      slot*   sl;
+      name    owner;
+      int64_t snapshot;
+      int64_t delta;
+   };
+
+   // one netting at a time; hold back new moves and drain the ones in flight
+   std::lock_guard<std::mutex> lock( _net_mutex );
+   _paused.store( true );
+   while( _in_flight.load() != 0 ) {
+      std::this_thread::yield();
+   }
+   struct resume {
+      std::atomic<bool>& paused;
+      ~resume() { paused.store( false, std::memory_order_release ); }
+   } resume_moves{ _paused };
+
+   std::vector<balance_change> debtors;
+   std::vector<balance_change> creditors;
+   int64_t total = 0;
+
+   for( auto& s : _shards ) {
+      for( size_t i = 0; i < s.capacity; ++i ) {
+         auto& sl = s.slots[i];
+         const auto owner = sl.owner.load( std::memory_order_acquire );
+         if( owner == 0 ) continue;
+         const auto snapshot = sl.balance.load( std::memory_order_acquire );
+         const auto delta = snapshot - sl.baseline;
+         if( delta == 0 ) continue;
+         ( delta < 0 ? debtors : creditors ).push_back( { &sl, name( owner ), snapshot, delta } );
+         total += delta;
+      }
+   }
+   check( total == 0, "shadow ledger is not balanced" );
+
+   const auto by_magnitude = []( const balance_change& a, const balance_change& b ) {
+      return ( a.delta < 0 ? -a.delta : a.delta ) > ( b.delta < 0 ? -b.delta : b.delta );
+   };
+   std::sort( debtors.begin(), debtors.end(), by_magnitude );
+   std::sort( creditors.begin(), creditors.end(), by_magnitude );
+
+   std::vector<transfer> transfers;
+   size_t d = 0, c = 0;
+   int64_t owed = debtors.empty() ? 0 : -debtors[0].delta;
+   int64_t due  = creditors.empty() ? 0 : creditors[0].delta;
+   while( d < debtors.size() && c < creditors.size() ) {
+      const auto amount = std::min( owed, due );
+      transfers.push_back( { debtors[d].owner, creditors[c].owner, asset{ amount, _sym } } );
+      owed -= amount;
+      due  -= amount;
+      if( owed == 0 && ++d < debtors.size() ) owed = -debtors[d].delta;
+      if( due == 0 && ++c < creditors.size() ) due = creditors[c].delta;
+   }
+
+   for( const auto* changes : { &debtors, &creditors } ) {
+      for( const auto& ch : *changes ) {
+         ch.sl->baseline = ch.snapshot;
+      }
+   }
+   return transfers;
+}
+
+} /// namespace shadow
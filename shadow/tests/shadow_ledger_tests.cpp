@@ -0,0 +1,158 @@
+#include <shadow_ledger.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace shadow;
+
+namespace {
+
+   int failures = 0;
+
+   void expect( bool pred, const char* what ) {
+      if( !pred ) {
+         std::fprintf( stderr, "FAILED: %s\n", what );
+         ++failures;
+      }
+   }
+
+   template<typename F>
+   void expect_failure( F&& f, const char* msg ) {
+      try {
+         f();
+         std::fprintf( stderr, "FAILED: expected \"%s\"\n", msg );
+         ++failures;
+      } catch( const check_failure& e ) {
+         if( std::strcmp( e.what(), msg ) != 0 ) {
+            std::fprintf( stderr, "FAILED: expected \"%s\", got \"%s\"\n", msg, e.what() );
+            ++failures;
+         }
+      }
+   }
+
+   const symbol apoc( "APOC", 5 );
+
+   asset apoc_amount( int64_t amount ) {
+      return asset{ amount, apoc };
+   }
+
+   void overdraw() {
+      ledger l( apoc, 4, 8 );
+      l.load( name( "alice" ), apoc_amount( 100 ) );
+
+      expect_failure( [&]{ l.move( name( "alice" ), name( "bob" ), apoc_amount( 101 ) ); }, "overdrawn balance" );
+      expect_failure( [&]{ l.move( name( "carol" ), name( "alice" ), apoc_amount( 1 ) ); }, "no balance object found" );
+      expect( l.balance( name( "alice" ) ).amount == 100, "overdraw leaves the source untouched" );
+
+      l.move( name( "alice" ), name( "bob" ), apoc_amount( 100 ) );
+      expect( l.balance( name( "alice" ) ).amount == 0, "a move may empty the source" );
+      expect( l.balance( name( "bob" ) ).amount == 100, "a move credits the destination" );
+   }
+
+   void symbol_mismatch() {
+      ledger l( apoc, 4, 8 );
+      l.load( name( "alice" ), apoc_amount( 100 ) );
+
+      expect_failure( [&]{ l.move( name( "alice" ), name( "bob" ), asset{ 1, symbol( "APOC", 4 ) } ); },
+                      "symbol precision mismatch" );
+      expect_failure( [&]{ l.move( name( "alice" ), name( "bob" ), asset{ 1, symbol( "EOS", 5 ) } ); },
+                      "symbol precision mismatch" );
+      expect_failure( [&]{ l.load( name( "bob" ), asset{ 1, symbol( "EOS", 5 ) } ); },
+                      "symbol precision mismatch" );
+      expect( l.balance( name( "alice" ) ).amount == 100, "a rejected move leaves the source untouched" );
+   }
+
+   void overflow_rollback() {
+      ledger l( apoc, 4, 8 );
+      l.load( name( "alice" ), apoc_amount( 10 ) );
+      l.load( name( "bob" ), apoc_amount( asset::max_amount - 5 ) );
+
+      // the debit succeeds, the credit overflows and must be rolled back
+      expect_failure( [&]{ l.move( name( "alice" ), name( "bob" ), apoc_amount( 10 ) ); }, "addition overflow" );
+      expect( l.balance( name( "alice" ) ).amount == 10, "a failed credit restores the source" );
+      expect( l.balance( name( "bob" ) ).amount == asset::max_amount - 5, "a failed credit leaves the destination" );
+      expect( l.net().empty(), "a rolled back move nets to nothing" );
+   }
+
+   void net_invariant() {
+      ledger l( apoc, 4, 16 );
+      std::map<std::string, int64_t> baseline = { { "alice", 500 }, { "bob", 300 }, { "carol", 0 }, { "dave", 50 } };
+      for( const auto& [owner, amount] : baseline ) {
+         l.load( name( owner ), apoc_amount( amount ) );
+      }
+
+      l.move( name( "alice" ), name( "bob" ), apoc_amount( 120 ) );
+      l.move( name( "bob" ), name( "carol" ), apoc_amount( 400 ) );
+      l.move( name( "dave" ), name( "alice" ), apoc_amount( 50 ) );
+      l.move( name( "carol" ), name( "erin" ), apoc_amount( 25 ) );
+
+      const auto transfers = l.net();
+      expect( transfers.size() < 5, "netting needs fewer transfers than changed accounts" );
+
+      // applying the netted transfers to the baseline reproduces the live balances
+      for( const auto& t : transfers ) {
+         expect( t.quantity.amount > 0 && t.quantity.sym == apoc, "netted transfers are positive APOC" );
+         baseline[t.from.to_string()] -= t.quantity.amount;
+         baseline[t.to.to_string()]   += t.quantity.amount;
+      }
+      for( const auto& [owner, amount] : baseline ) {
+         expect( amount >= 0, "netted transfers never overdraw the baseline" );
+         expect( l.balance( name( owner ) ).amount == amount, "netted transfers reproduce the live balances" );
+      }
+
+      expect( l.net().empty(), "netting makes the live balances the new baseline" );
+   }
+
+   void concurrent_net() {
+      ledger l( apoc, 4, 64 );
+      std::vector<name> owners;
+      for( const char* owner : { "alice", "bob", "carol", "dave", "erin", "frank" } ) {
+         owners.emplace_back( owner );
+         l.load( owners.back(), apoc_amount( 1000000 ) );
+      }
+
+      // net repeatedly while two threads keep moving; each snapshot must balance
+      std::vector<std::thread> movers;
+      for( size_t t = 0; t < 2; ++t ) {
+         movers.emplace_back( [&, t]() {
+            for( size_t i = 0; i < 20000; ++i ) {
+               l.move( owners[( i + t ) % owners.size()], owners[( i * 5 + t + 1 ) % owners.size()], apoc_amount( 1 ) );
+            }
+         });
+      }
+      std::map<uint64_t, int64_t> netted;
+      const auto net = [&]() {
+         for( const auto& t : l.net() ) {
+            netted[t.from.value] -= t.quantity.amount;
+            netted[t.to.value]   += t.quantity.amount;
+         }
+      };
+      for( size_t i = 0; i < 50; ++i ) {
+         net();
+         std::this_thread::yield();
+      }
+      for( auto& m : movers ) {
+         m.join();
+      }
+      net();
+
+      for( const auto& owner : owners ) {
+         expect( l.balance( owner ).amount == 1000000 + netted[owner.value],
+                 "nettings taken during moves reproduce the live balances" );
+      }
+   }
+
+} /// anonymous namespace
+
+int main() {
+   overdraw();
+   symbol_mismatch();
+   overflow_rollback();
+   net_invariant();
+   concurrent_net();
+   return failures == 0 ? 0 : 1;
+}
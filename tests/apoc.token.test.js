@@ -1,4 +1,6 @@
+const crypto = require("crypto");
 const { loadConfig, Blockchain } = require("@klevoya/hydra");
+const { pack } = require("../bench/lib/serialize");
 
 const config = loadConfig("hydra.yml");
 
@@ -7,6 +9,8 @@ describe("apoc.token", () => {
   let tester = blockchain.createAccount(`apoc.token`);
   let alice = blockchain.createAccount(`alice`);
   let bob = blockchain.createAccount(`bob`);
+  let game = blockchain.createAccount(`game`);
+  let carol = blockchain.createAccount(`carol`);
 
   beforeAll(async () => {
     tester.setContract(blockchain.contractTemplates[`apoc.token`]);
@@ -72,6 +76,147 @@ describe("apoc.token", () => {
     });
   });
 
+  it("can transfer tokens with a deposit tag", async () => {
+    expect.assertions(2);
+
+    const trace = await tester.contract.transfertag(
+      {
+        from: bob.accountName,
+        to: alice.accountName,
+        quantity: `1.00000 APOC`,
+        tag: `42`,
+      },
+      [{ actor: bob.accountName, permission: `active` }]
+    );
+
+    // uint64 return values are decoded as strings
+    expect(trace.action_traces[0].return_value_data).toEqual(`42`);
+    expect(tester.getTableRowsScoped(`accounts`)).toEqual({
+      alice: [{ balance: "6.00000 APOC" }],
+      bob: [{ balance: "4.00000 APOC" }],
+    });
+  });
+
+  it("can transfer tokens with a session permit", async () => {
+    expect.assertions(2);
+
+    await tester.contract.setpermit(
+      {
+        owner: alice.accountName,
+        session: game.accountName,
+        cap: `2.00000 APOC`,
+        expiration: `2100-01-01T00:00:00`,
+      },
+      [{ actor: alice.accountName, permission: `active` }]
+    );
+
+    await tester.contract.transfer(
+      {
+        from: alice.accountName,
+        to: bob.accountName,
+        quantity: `1.50000 APOC`,
+        memo: ``,
+      },
+      [{ actor: game.accountName, permission: `active` }]
+    );
+
+    expect(tester.getTableRowsScoped(`permits`)[tester.accountName]).toEqual([
+      {
+        owner: `alice`,
+        session: `game`,
+        remaining: "0.50000 APOC",
+        expiration: "2100-01-01T00:00:00",
+      },
+    ]);
+
+    await expect(
+      tester.contract.transfer(
+        {
+          from: alice.accountName,
+          to: bob.accountName,
+          quantity: `1.00000 APOC`,
+          memo: ``,
+        },
+        [{ actor: game.accountName, permission: `active` }]
+      )
+    ).rejects.toThrowError(`spending permit cap exceeded`);
+  });
+
+  it("can evict and revive dormant balances", async () => {
+    expect.assertions(2);
+
+    await tester.contract.evict(
+      {
+        symbol: `5,APOC`,
+        owners: [bob.accountName],
+      },
+      [{ actor: tester.accountName, permission: `active` }]
+    );
+    expect(tester.getTableRowsScoped(`accounts`)[bob.accountName]).toBeUndefined();
+
+    // a single-leaf batch has the leaf hash as its root and an empty proof
+    await tester.contract.revive(
+      {
+        owner: bob.accountName,
+        batch_id: 0,
+        balance: `5.50000 APOC`,
+        leaf_index: 0,
+        proof: [],
+        ram_payer: bob.accountName,
+      },
+      [{ actor: bob.accountName, permission: `active` }]
+    );
+    expect(tester.getTableRowsScoped(`accounts`)[bob.accountName]).toEqual([
+      { balance: "5.50000 APOC" },
+    ]);
+  });
+
+  it("can sweep tokens from many accounts", async () => {
+    expect.assertions(1);
+
+    await tester.contract.sweep(
+      {
+        sources: [
+          { from: alice.accountName, quantity: `1.00000 APOC` },
+          { from: bob.accountName, quantity: `1.00000 APOC` },
+        ],
+        to: game.accountName,
+        memo: `consolidation`,
+      },
+      [
+        { actor: alice.accountName, permission: `active` },
+        { actor: bob.accountName, permission: `active` },
+      ]
+    );
+
+    expect(tester.getTableRowsScoped(`accounts`)).toEqual({
+      alice: [{ balance: "3.50000 APOC" }],
+      bob: [{ balance: "4.50000 APOC" }],
+      game: [{ balance: "2.00000 APOC" }],
+    });
+  });
+
+  it("keeps a live balance distribution", async () => {
+    expect.assertions(1);
+
+    // alice 3.50000, bob 4.50000 and game 2.00000 APOC are all 6-digit amounts
+    const buckets = new Array(20).fill(`0`);
+    buckets[6] = `3`;
+    expect(tester.getTableRowsScoped(`histogram`)[`APOC`]).toEqual([
+      { sym: `5,APOC`, holders: buckets },
+    ]);
+  });
+
+  it("interns dense ids for new holders", async () => {
+    expect.assertions(1);
+
+    expect(tester.getTableRowsScoped(`holderids`)[tester.accountName]).toEqual([
+      { id: `0`, owner: `alice` },
+      { id: `1`, owner: `bob` },
+      { id: `2`, owner: `game` },
+    ]);
+  });
+
   it("can load balances from JSON files", async () => {
     expect.assertions(1);
     // need to reset stat and accounts table first
@@ -93,4 +238,261 @@ describe("apoc.token", () => {
       bob: [{ balance: "0.12345 APOC" }],
     });
   });
+
+  it("rejects expired and deleted session permits", async () => {
+    expect.assertions(3);
+
+    blockchain.setCurrentTime(new Date(`2029-06-01T00:00:00.000Z`));
+    await tester.contract.setpermit(
+      {
+        owner: alice.accountName,
+        session: game.accountName,
+        cap: `0.50000 APOC`,
+        expiration: `2030-01-01T00:00:00`,
+      },
+      [{ actor: alice.accountName, permission: `active` }]
+    );
+
+    blockchain.setCurrentTime(new Date(`2030-06-01T00:00:00.000Z`));
+    await expect(
+      tester.contract.transfer(
+        {
+          from: alice.accountName,
+          to: bob.accountName,
+          quantity: `0.10000 APOC`,
+          memo: ``,
+        },
+        [{ actor: game.accountName, permission: `active` }]
+      )
+    ).rejects.toThrowError(`spending permit has expired`);
+
+    await tester.contract.delpermit(
+      { owner: alice.accountName },
+      [{ actor: alice.accountName, permission: `active` }]
+    );
+    expect(tester.getTableRowsScoped(`permits`)[tester.accountName]).toBeUndefined();
+
+    await expect(
+      tester.contract.transfer(
+        {
+          from: alice.accountName,
+          to: bob.accountName,
+          quantity: `0.10000 APOC`,
+          memo: ``,
+        },
+        [{ actor: game.accountName, permission: `active` }]
+      )
+    ).rejects.toThrowError(`missing authority of alice`);
+  });
+
+  it("can mint tokens directly to recipients", async () => {
+    expect.assertions(2);
+
+    await tester.contract.setminter(
+      {
+        minter: game.accountName,
+        quota: "3.00000 APOC",
+      },
+      [{ actor: tester.accountName, permission: `active` }]
+    );
+
+    await tester.contract.mint(
+      {
+        minter: game.accountName,
+        to: bob.accountName,
+        quantity: "2.00000 APOC",
+        memo: `reward`,
+      },
+      [{ actor: game.accountName, permission: `active` }]
+    );
+
+    expect(tester.getTableRowsScoped(`minters`)[`APOC`]).toEqual([
+      {
+        minter: `game`,
+        quota: "1.00000 APOC",
+      },
+    ]);
+    expect(tester.getTableRowsScoped(`accounts`)[bob.accountName]).toEqual([
+      {
+        balance: "2.12345 APOC",
+      },
+    ]);
+  });
+
+  it("can revive balances from a multi-leaf batch", async () => {
+    expect.assertions(6);
+
+    await tester.contract.transfer(
+      {
+        from: alice.accountName,
+        to: game.accountName,
+        quantity: `0.25000 APOC`,
+        memo: ``,
+      },
+      [{ actor: alice.accountName, permission: `active` }]
+    );
+    const owners = [alice.accountName, bob.accountName, game.accountName];
+    const trace = await tester.contract.evict(
+      { symbol: `5,APOC`, owners },
+      [{ actor: tester.accountName, permission: `active` }]
+    );
+    const evicted = trace.action_traces[0].return_value_data;
+    expect(evicted).toEqual({
+      batch_id: `0`,
+      balances: [`0.75000 APOC`, `2.12345 APOC`, `0.25000 APOC`],
+    });
+
+    // the leaves are rebuilt from the trace alone
+    // the odd third leaf is carried up unhashed: root = H(H(L0, L1), L2)
+    const sha256 = (data) => crypto.createHash(`sha256`).update(data).digest();
+    const leaf = (owner, balance) =>
+      sha256(pack((w) => w.uint64(evicted.batch_id).name(owner).asset(balance)));
+    const parent = (left, right) => sha256(Buffer.concat([left, right]));
+    const hex = (hash) => hash.toString(`hex`);
+    const leaves = owners.map((owner, i) => leaf(owner, evicted.balances[i]));
+    const reviveBob = (proof) =>
+      tester.contract.revive(
+        {
+          owner: bob.accountName,
+          batch_id: 0,
+          balance: `2.12345 APOC`,
+          leaf_index: 1,
+          proof: proof.map(hex),
+          ram_payer: bob.accountName,
+        },
+        [{ actor: bob.accountName, permission: `active` }]
+      );
+
+    const tampered = Buffer.from(leaves[0]);
+    tampered[0] ^= 1;
+    await expect(reviveBob([tampered, leaves[2]])).rejects.toThrowError(
+      `invalid cold balance proof`
+    );
+
+    await reviveBob([leaves[0], leaves[2]]);
+    expect(tester.getTableRowsScoped(`accounts`)[bob.accountName]).toEqual([
+      { balance: "2.12345 APOC" },
+    ]);
+
+    // bob's leaf is now cleared, so the same proof no longer matches
+    await expect(reviveBob([leaves[0], leaves[2]])).rejects.toThrowError(
+      `invalid cold balance proof`
+    );
+
+    await tester.contract.revive(
+      {
+        owner: game.accountName,
+        batch_id: 0,
+        balance: `0.25000 APOC`,
+        leaf_index: 2,
+        proof: [hex(parent(leaves[0], Buffer.alloc(32)))],
+        ram_payer: game.accountName,
+      },
+      [{ actor: game.accountName, permission: `active` }]
+    );
+    expect(tester.getTableRowsScoped(`accounts`)).toEqual({
+      bob: [{ balance: "2.12345 APOC" }],
+      game: [{ balance: "0.25000 APOC" }],
+    });
+    expect(tester.getTableRowsScoped(`coldbatches`)[`APOC`]).toEqual([
+      {
+        id: `0`,
+        root: hex(parent(parent(leaves[0], Buffer.alloc(32)), Buffer.alloc(32))),
+        leaves: `3`,
+        live: `1`,
+      },
+    ]);
+  });
+
+  it("interns an id for opened balances", async () => {
+    expect.assertions(2);
+
+    await tester.contract.open(
+      {
+        owner: carol.accountName,
+        symbol: `5,APOC`,
+        ram_payer: tester.accountName,
+      },
+      [{ actor: tester.accountName, permission: `active` }]
+    );
+    await tester.contract.transfer(
+      {
+        from: bob.accountName,
+        to: carol.accountName,
+        quantity: `0.12345 APOC`,
+        memo: ``,
+      },
+      [{ actor: bob.accountName, permission: `active` }]
+    );
+
+    // after the fixtures bob is interned on the first credit (0) and game on its first balance (1)
+    const trace = await tester.contract.holderid(
+      { owner: carol.accountName },
+      [{ actor: carol.accountName, permission: `active` }]
+    );
+    expect(trace.action_traces[0].return_value_data).toEqual(2);
+    expect(tester.getTableRowsScoped(`accounts`)[carol.accountName]).toEqual([
+      { balance: "0.12345 APOC" },
+    ]);
+  });
+
+  it("returns the balance distribution", async () => {
+    expect.assertions(1);
+
+    // alice was loaded as a fixture and never credited since, so the debits and eviction of that
+    // row were not counted; bob 2.00000 is a 6-digit amount, game 0.25000 and carol 0.12345 are 5-digit
+    const trace = await tester.contract.distribution(
+      { sym_code: `APOC` },
+      [{ actor: tester.accountName, permission: `active` }]
+    );
+    const buckets = new Array(20).fill(`0`);
+    buckets[5] = `2`;
+    buckets[6] = `1`;
+    expect(trace.action_traces[0].return_value_data).toEqual(buckets);
+  });
+
+  it("counts histogram rows per symbol and backfills fixture rows", async () => {
+    expect.assertions(2);
+    tester.resetTables();
+    await tester.loadFixtures();
+
+    // interning alice through another token must not mark her fixture APOC row as counted
+    await tester.contract.create({
+      issuer: alice.accountName,
+      maximum_supply: "100.0000 GEM",
+    });
+    await tester.contract.issue(
+      { to: alice.accountName, quantity: "1.0000 GEM", memo: `` },
+      [{ actor: alice.accountName, permission: `active` }]
+    );
+    // alice drops from 6 to 5 digits uncounted, bob's fixture row is counted on its first credit
+    await tester.contract.transfer(
+      {
+        from: alice.accountName,
+        to: bob.accountName,
+        quantity: `0.50000 APOC`,
+        memo: ``,
+      },
+      [{ actor: alice.accountName, permission: `active` }]
+    );
+
+    const distribution = async () =>
+      (
+        await tester.contract.distribution(
+          { sym_code: `APOC` },
+          [{ actor: tester.accountName, permission: `active` }]
+        )
+      ).action_traces[0].return_value_data;
+    const buckets = new Array(20).fill(`0`);
+    buckets[5] = `1`;
+    expect(await distribution()).toEqual(buckets);
+
+    // bob is already counted and skipped, alice 0.62345 APOC is added
+    await tester.contract.histbackfill(
+      { sym_code: `APOC`, owners: [alice.accountName, bob.accountName] },
+      [{ actor: tester.accountName, permission: `active` }]
+    );
+    buckets[5] = `2`;
+    expect(await distribution()).toEqual(buckets);
+  });
 });